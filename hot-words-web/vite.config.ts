@@ -20,6 +20,7 @@ export default defineConfig({
       '/api': {
         target: 'http://backend:18080', // C++Crow 服务器地址
         changeOrigin: true,
+        ws: true, // /api/stream 推送走 WebSocket
       }
     }
   }
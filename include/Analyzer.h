@@ -4,15 +4,24 @@
 #include <deque>
 #include <unordered_map>
 #include <set>
+#include <bitset>
 #include <shared_mutex>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
 #include "Utils.h"
+#include "CooccurrenceGraph.h"
+#include "ColdArchive.h"
+#include "Tokenizer.h"
 #include "cppjieba/Jieba.hpp"
 #include <iostream>
 #include <algorithm>
 
 using ll = long long;
 
+class WriteAheadLog;
+
 struct StreamItem {
     long long timestamp;
     std::string word;
@@ -25,19 +34,48 @@ struct TimeBucket {
     std::unordered_map<std::string, int> word_counts;
 };
 
+struct KeywordItem {
+    std::string word;
+    int count;         // 窗口内词频 (TF)
+    double score;      // TF * IDF
+};
+
+// TF-IDF 中 IDF 的来源
+enum class IdfSource {
+    Static,      // 词典自带的 idf.utf8（通用语料）
+    Background,  // 本系统的长期全局词频 global_counts_ 作为背景语料
+};
+
+// 额外的滑动窗口（1 分钟、1 小时 ...），和 10 分钟窗口共用历史桶，随桶过期增量维护
+struct SlidingWindow {
+    std::string name;      // 查询时用的名字，如 "5m"
+    long long duration_ms;
+    std::unordered_map<std::string, int> counts;
+    std::set<std::pair<int, std::string>> ranking; // 和 ranking_set_ 一样，查询 O(K)
+    std::size_t start_index = 0; // 窗口在历史桶的起始下标
+};
+
 struct TrendItem {
     std::string word;
     double slope;      // 斜率 (增长速率)
     int total_count;   // 当前窗口内总词频
 };
 
+// 做快照时看到的完整状态（见 WriteAheadLog.h）
+struct StateView {
+    const std::deque<TimeBucket>& buckets;        // 内存里的时间桶（热数据）
+    const std::vector<TimeBucket>& sealing;       // 正在写冷存储、还没写成段文件的时间桶
+    const std::unordered_map<std::string, uint8_t>& tags;
+    std::vector<std::string> cold_segments;       // 已经在冷存储里的段文件
+};
+
 class Analyzer {
 private:
-    // 1. 核心 Jieba 组件 (初始化很慢，只初始化一次)
-    cppjieba::Jieba jieba_;
+    // 1. 核心 Jieba 组件 (初始化很慢，只初始化一次；多个频道的 Analyzer 共用一份)
+    std::shared_ptr<cppjieba::Jieba> jieba_;
 
     // 2. 数据结构
-    std::deque<TimeBucket> history_buckets_; // 所有的历史记录分桶
+    std::deque<TimeBucket> history_buckets_; // 历史记录分桶（开了冷存储时只有热数据）
     std::unordered_map<std::string, int> global_counts_; // 全局总词频 (O(1)查询)
     
     // 3. 实时 Top-K 排序
@@ -50,20 +88,61 @@ private:
     std::unordered_map<std::string, int> window_counts_;
     // std::set<std::pair<int, std::string>> window_ranking_;
     std::size_t window_start_index_ = 0;    //窗口在历史桶的起始下标
+    std::vector<SlidingWindow> extra_windows_; // 启动时注册的其它窗口，每个词每个窗口多一次计数更新
+
+    // 4.1 窗口 TF-IDF 排名：和 ranking_set_ 一样随计数增量维护，查询 O(K)
+    IdfSource idf_source_ = IdfSource::Static;
+    std::set<std::pair<double, std::string>> window_tfidf_ranking_;
+    std::unordered_map<std::string, double> window_scores_; // 词 -> 当前在排名里的分数
+    long long global_total_ = 0;            // 全局总词频，背景语料模式下算 IDF 用
+    double background_log_total_ = 0.0;     // 冻结的 log(总词频)，定期刷新
+    long long last_idf_refresh_time_ = 0;
+    const ll IDF_REFRESH_INTERVAL_MS = 60 * 1000;
+
+    // 4.2 按词性计数：只统计这些词性的词，为空时按长度过滤（启动前配置）
+    std::vector<std::string> pos_classes_;
+    std::unordered_map<std::string, uint8_t> word_tags_; // 词 -> 词性 id（第一次见到时记下）
+    bool multi_granularity_ = false; // 多粒度计数：长词和它里面的词典词都计数（启动前配置）
+
+    // 4.3 分词后端（启动前配置）
+#ifdef BENCHMARK_MOCK_JIEBA
+    TokenizerKind tokenizer_kind_ = TokenizerKind::Whitespace; // 压测聚合层，分词不能成为瓶颈
+#else
+    TokenizerKind tokenizer_kind_ = TokenizerKind::Mix;
+#endif
+    std::unique_ptr<Tokenizer> tokenizer_;
+
+    // 4.4 窗口共现图（自带锁，不占用 mutex_）
+    CooccurrenceGraph graph_{WINDOW_DURATION_MS};
 
     // 5. 线程锁
     // mutable 允许在 const 函数 (如 get_top_k) 中被上锁
     mutable std::shared_mutex mutex_; 
+    std::atomic<uint64_t> data_version_{0}; // 提交计数：每次写入统计数据都加一，查询结果随之可能变化
+    WriteAheadLog* wal_ = nullptr; // 每批写入都记一份增量，为空表示不持久化
+
+    // 5.1 冷存储：滑出所有窗口、又超过 hot_duration_ms_ 的桶写成段文件（见 ColdArchive.h），为空表示全放内存
+    std::unique_ptr<ColdArchive> cold_;
+    long long hot_duration_ms_ = 0;
+    std::vector<TimeBucket> sealing_; // 已从 history_buckets_ 移出、正在写段文件的桶，写完前查询照样能看到
 
     // 6. 工具函数：更新set排名用
     void UpdateRankingSet(std::set<std::pair<int, std::string>>& rank_set, 
         const std::string& word, int old_count, int new_count);
+    double GetIdf(const std::string& word) const;
+    void UpdateWindowScore(const std::string& word); // 按当前窗口词频重算一个词的 TF-IDF
+    void RebuildWindowScores();
+    void ExpireWindow(SlidingWindow& window, long long latest_time); // 把滑出窗口的桶从计数里减掉
+    const SlidingWindow* FindWindow(const std::string& name) const;
 
 public:
     // 构造函数
     Analyzer(const std::string& dict_path, const std::string& hmm_path, 
              const std::string& user_dict_path, const std::string& idf_path, 
              const std::string& stop_word_path);
+    explicit Analyzer(std::shared_ptr<cppjieba::Jieba> jieba); // 共用已加载的 jieba（按频道统计时用）
+    std::shared_ptr<cppjieba::Jieba> GetSharedJieba() const;
+    void CopyConfigFrom(const Analyzer& other); // 照搬另一个 Analyzer 的配置，需在处理开始前调用
 
     // 写接口[单线程]（已被弃用，项目中未使用）
     void Ingest(const std::string& line);
@@ -72,12 +151,49 @@ public:
         多线程写接口
     */
     void Split(const std::string& sentence, std::vector<std::string>& words) const; // 暴露无锁分词
-    void IngestBatch(const std::unordered_map<std::string, int>& local_counts, long long timestamp);    //写入统计好的数据（批量防止排队）
+    void Split(const std::string& sentence, std::vector<cppjieba::WordToken>& tokens) const; // 分词，词典词不拼字符串
+    void SplitBatch(const cppjieba::DictHandle& dict, const std::vector<std::string>& sentences,
+                    std::vector<cppjieba::WordToken>& tokens, std::vector<std::size_t>& offsets,
+                    cppjieba::SegmentScratch& scratch) const; // 一次切一批，复用缓冲区
+    void GetWord(const cppjieba::DictHandle& dict, const cppjieba::DictUnit* unit,
+                 std::string& word) const; // 词典词 -> 字符串，unit 必须属于 dict 这个版本
+    void FindSplitPoints(const cppjieba::DictHandle& dict, const std::string& sentence, std::size_t piece_bytes,
+                         std::vector<std::size_t>& bounds) const; // 超长行在分隔符处切成可独立分词的小段
+
+    // 词典热更新
+    cppjieba::DictHandle AcquireDict() const; // 当前词典版本，持有期间其中的 DictUnit 指针一直有效
+    uint64_t UpdateDictionary(const std::vector<std::pair<std::string, std::string>>& inserts,
+                              const std::vector<std::string>& deletes); // 后台构建新词典并原子替换，返回新版本号
+    void SetPosClasses(const std::vector<std::string>& tags); // 只统计这些词性（如 n,nr,ns,nt,nz,eng），需在处理开始前设置
+    void SetMultiGranularity(bool enabled); // 多粒度计数（"中华人民共和国"和"人民"都计），需在处理开始前设置
+    void SetTokenizer(TokenizerKind kind); // 切换分词后端，需在处理开始前设置
+    void AddWindow(const std::string& name, long long duration_ms); // 注册一个滑动窗口（如 "5m"），需在处理开始前设置
+    const char* GetTokenizerName() const;
+    bool GetPosFilter(const cppjieba::DictHandle& dict, std::bitset<256>& filter) const; // 词性 id 过滤表，未配置时返回 false
+    void IngestBatch(const std::unordered_map<std::string, int>& local_counts, long long timestamp,
+                     const std::unordered_map<std::string, uint8_t>* tags = nullptr);    //写入统计好的数据（批量防止排队），可附带词性
+    void IngestEdges(const std::vector<WordEdge>& edges, long long timestamp); // 写入同一行内的词共现
+    uint64_t GetDataVersion() const; // 提交计数，不变则所有查询结果不变（响应缓存用）
+
+    // 持久化（见 WriteAheadLog.h）
+    void AttachWal(WriteAheadLog* wal); // 之后每次 IngestBatch 都写日志，需在恢复完成、处理开始前调用
+    void VisitState(const std::function<void(const StateView&)>& visitor) const; // 读锁内访问所有时间桶（做快照）
+    void EnableColdArchive(const std::string& dir, long long hot_duration_ms); // 打开冷存储，需在恢复和处理开始前设置
+    bool RestoreColdArchive(const std::vector<std::string>& segments); // 恢复时打开快照记录的段，并把它们计入全局词频
+    std::size_t ArchiveColdBuckets(); // 把够老的桶写进冷存储，返回移出的桶数（由快照线程调用）
+    long long GetHotDuration() const; // 热数据保留时长，没打开冷存储时为 -1
+    bool GetColdStats(std::size_t& segments, std::size_t& buckets, std::size_t& bytes) const; // 没打开冷存储时返回 false
 
     // 查询
     std::vector<std::pair<std::string, int>> GetTopK(int k);    // 全量查询
     std::vector<std::pair<std::string, int>> GetTopKInTimeRange(long long start_ts, long long end_ts, int k); // 任意时间段
     std::vector<std::pair<std::string, int>> GetLast10MinTopK(int k); // 10分钟窗口
+    std::vector<KeywordItem> GetLast10MinKeywords(int k); // 10分钟窗口，按 TF-IDF 排名
+    std::vector<std::pair<std::string, int>> GetLast10MinTopKByPos(const std::string& pos, int k); // 10分钟窗口，只看某个词性
+    bool HasWindow(const std::string& name) const; // 是否注册过这个窗口
+    std::vector<std::pair<std::string, int>> GetWindowTopK(const std::string& name, int k); // 注册的窗口，未注册时为空
+    void SetIdfSource(IdfSource source); // 切换 IDF 来源，会重建 TF-IDF 排名
+    std::vector<std::pair<std::string, double>> GetTopTopics(int k); // 窗口共现图上 PageRank 最高的词
     std::vector<TrendItem> GetTrending(int k, int min_threshold); // 当前趋势查询
     
     // 调试用：打印当前状态
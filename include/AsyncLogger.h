@@ -0,0 +1,355 @@
+/*
+    异步日志：请求线程、分词线程只把一条记录拷进本线程的环形缓冲区，格式化时间和写终端都在后台线程做
+
+    原来各处直接 std::cout << ... << std::endl，每条都 flush，还要抢 stdout 的锁；limonp 的 XLOG 也一样。
+    - 每个线程一个单生产者单消费者的环形缓冲区（64KB），写入只有两个原子变量的读写，不加锁、不分配内存
+    - 缓冲区满了就丢弃这条并计数，绝不阻塞调用线程；后台线程下次刷新时报告丢了多少条
+    - 后台线程每 50ms 把所有线程的缓冲区倒出来，拼好时间前缀，一次 fwrite + fflush
+      （INFO 及以下写 stdout，WARN 及以上写 stderr；不同线程之间的先后顺序不保证，以时间戳为准）
+    - 级别：LOG(DEBUG) ... LOG(FATAL)，低于 SetLevel 的直接跳过，<< 后面的表达式都不会求值
+    - 限流：每个 LOG 调用点每秒最多 20 条（LOG_EVERY(level, n) 自定义），
+      超出的丢弃，下一条放行的记录末尾带上被压掉的条数；ERROR 和 FATAL 不限流
+    - FATAL：不受级别和限流影响，同步刷出所有缓冲区再 abort
+    limonp 的 XLOG 通过 limonp::SetLogSink 接到这里（见构造函数）
+*/
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <charconv>
+#include <sstream>
+#include <type_traits>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include "cppjieba/limonp/Logging.hpp"
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3,
+    Fatal = 4,
+};
+
+// LOG(INFO) 里的 INFO 靠 ## 拼成这些名字，不会被 -DDEBUG 之类的宏展开
+constexpr LogLevel LOG_LEVEL_DEBUG = LogLevel::Debug;
+constexpr LogLevel LOG_LEVEL_INFO = LogLevel::Info;
+constexpr LogLevel LOG_LEVEL_WARN = LogLevel::Warn;
+constexpr LogLevel LOG_LEVEL_ERROR = LogLevel::Error;
+constexpr LogLevel LOG_LEVEL_FATAL = LogLevel::Fatal;
+
+// 一个 LOG 调用点的限流状态（宏里的函数内 static）
+struct LogSite {
+    const uint32_t max_per_sec;
+    std::atomic<int64_t> window{0};       // 当前计数的是哪一秒
+    std::atomic<uint32_t> count{0};       // 这一秒已经放行 + 尝试的条数
+    std::atomic<uint32_t> suppressed{0};  // 被压掉、还没报告的条数
+
+    explicit LogSite(uint32_t max) : max_per_sec(max) {
+    }
+};
+
+class AsyncLogger {
+private:
+    static const std::size_t kRingSize = 64 * 1024; // 2 的幂
+    static const std::size_t kHeaderSize = 1 + 4 + 8; // 级别 + 正文长度 + 毫秒时间戳
+
+    // 单生产者（所属线程）单消费者（刷新线程）的字节环；记录是 [级别][长度][时间戳][正文]
+    struct ThreadBuffer {
+        char data[kRingSize];
+        std::atomic<uint64_t> head{0}; // 生产者写到哪（只增不减）
+        std::atomic<uint64_t> tail{0}; // 消费者读到哪
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false}; // 线程已退出，倒空后就可以回收
+
+        void CopyIn(uint64_t pos, const void* src, std::size_t n) {
+            std::size_t off = pos & (kRingSize - 1);
+            std::size_t first = std::min(n, kRingSize - off);
+            std::memcpy(data + off, src, first);
+            std::memcpy(data, (const char*)src + first, n - first);
+        }
+
+        void CopyOut(uint64_t pos, void* dst, std::size_t n) const {
+            std::size_t off = pos & (kRingSize - 1);
+            std::size_t first = std::min(n, kRingSize - off);
+            std::memcpy(dst, data + off, first);
+            std::memcpy((char*)dst + first, data, n - first);
+        }
+    };
+
+    // 线程退出时把缓冲区标记为 retired，由刷新线程倒空后释放
+    struct ThreadHandle {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~ThreadHandle() {
+            if (buffer) buffer->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    std::atomic<int> min_level_{(int)LogLevel::Info};
+
+    std::mutex registry_mutex_; // 只在线程第一次写日志时和刷新线程取列表时用
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    std::mutex drain_mutex_; // 消费端只能有一个：刷新线程和 FATAL 的同步刷新互斥
+    std::string out_text_;
+    std::string err_text_;
+    std::string record_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stop_ = false;
+    std::thread flusher_;
+
+    ThreadBuffer* LocalBuffer() {
+        thread_local ThreadHandle handle;
+        if (!handle.buffer) {
+            handle.buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            buffers_.push_back(handle.buffer);
+        }
+        return handle.buffer.get();
+    }
+
+    static void AppendTimePrefix(std::string& out, int64_t ts_ms, LogLevel level) {
+        static const char* kNames[] = {"DEBUG", "INFO ", "WARN ", "ERROR", "FATAL"};
+        time_t secs = (time_t)(ts_ms / 1000);
+        struct tm tm_now;
+        localtime_r(&secs, &tm_now);
+        char buf[48];
+        std::size_t n = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_now);
+        n += std::snprintf(buf + n, sizeof(buf) - n, ".%03d ", (int)(ts_ms % 1000));
+        out.append(buf, n);
+        out += kNames[(int)level];
+        out += ' ';
+    }
+
+    // 调用方持有 drain_mutex_
+    void DrainLocked() {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            buffers = buffers_;
+        }
+        uint64_t dropped = 0;
+        for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+            // 先读 retired 再倒：看到 retired 之后倒空的就是最后的数据
+            bool retired = buffer->retired.load(std::memory_order_acquire);
+            uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            while (tail != head) {
+                char header[kHeaderSize];
+                buffer->CopyOut(tail, header, kHeaderSize);
+                LogLevel level = (LogLevel)header[0];
+                uint32_t len;
+                int64_t ts_ms;
+                std::memcpy(&len, header + 1, 4);
+                std::memcpy(&ts_ms, header + 5, 8);
+                record_.resize(len);
+                buffer->CopyOut(tail + kHeaderSize, record_.data(), len);
+                tail += kHeaderSize + len;
+
+                std::string& out = level >= LogLevel::Warn ? err_text_ : out_text_;
+                AppendTimePrefix(out, ts_ms, level);
+                out += record_;
+                out += '\n';
+            }
+            buffer->tail.store(tail, std::memory_order_release);
+            dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+            if (retired) {
+                std::lock_guard<std::mutex> lock(registry_mutex_);
+                for (std::size_t i = 0; i < buffers_.size(); ++i) {
+                    if (buffers_[i] == buffer) {
+                        buffers_.erase(buffers_.begin() + i);
+                        break;
+                    }
+                }
+            }
+        }
+        if (dropped > 0) {
+            int64_t now = NowMs();
+            AppendTimePrefix(err_text_, now, LogLevel::Warn);
+            err_text_ += "[Log] buffer full, dropped " + std::to_string(dropped) + " records";
+            err_text_ += '\n';
+        }
+        if (!out_text_.empty()) {
+            std::fwrite(out_text_.data(), 1, out_text_.size(), stdout);
+            std::fflush(stdout);
+            out_text_.clear();
+        }
+        if (!err_text_.empty()) {
+            std::fwrite(err_text_.data(), 1, err_text_.size(), stderr);
+            std::fflush(stderr);
+            err_text_.clear();
+        }
+    }
+
+    void FlushLoop() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (!stop_) {
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(50), [this] { return stop_; });
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+
+    static void LimonpSink(size_t level, const std::string& message) {
+        LogLevel mapped = level >= limonp::LL_FATAL ? LogLevel::Fatal
+                        : level >= limonp::LL_ERROR ? LogLevel::Error
+                        : level >= limonp::LL_WARNING ? LogLevel::Warn
+                        : level >= limonp::LL_INFO ? LogLevel::Info : LogLevel::Debug;
+        AsyncLogger& logger = Instance();
+        if (!logger.Enabled(mapped)) return;
+        logger.Submit(mapped, NowMs(), message);
+        if (mapped == LogLevel::Fatal) logger.Flush(); // limonp 自己 abort
+    }
+
+    AsyncLogger() {
+        flusher_ = std::thread(&AsyncLogger::FlushLoop, this);
+        limonp::SetLogSink(&AsyncLogger::LimonpSink);
+    }
+
+public:
+    static AsyncLogger& Instance() {
+        static AsyncLogger logger;
+        return logger;
+    }
+
+    ~AsyncLogger() {
+        limonp::SetLogSink(NULL);
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_cv_.notify_all();
+        if (flusher_.joinable()) flusher_.join();
+        Flush();
+    }
+
+    static int64_t NowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void SetLevel(LogLevel level) {
+        min_level_.store((int)level, std::memory_order_relaxed);
+    }
+
+    bool Enabled(LogLevel level) const {
+        return (int)level >= min_level_.load(std::memory_order_relaxed);
+    }
+
+    // 级别和限流都通过时返回 &site，否则返回空。
+    // FATAL 一定放行（否则被压掉就不会 abort），ERROR 不限流：缓冲区满了照样丢，不会阻塞调用线程
+    LogSite* Admit(LogLevel level, LogSite& site) {
+        if (level >= LogLevel::Error) return level == LogLevel::Fatal || Enabled(level) ? &site : nullptr;
+        if (!Enabled(level)) return nullptr;
+        int64_t now_sec = NowMs() / 1000;
+        int64_t window = site.window.load(std::memory_order_relaxed);
+        if (window != now_sec && site.window.compare_exchange_strong(window, now_sec, std::memory_order_relaxed)) {
+            site.count.store(0, std::memory_order_relaxed);
+        }
+        if (site.count.fetch_add(1, std::memory_order_relaxed) < site.max_per_sec) return &site;
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // 把一条记录放进本线程的缓冲区；放不下就丢弃（计数），从不阻塞
+    void Submit(LogLevel level, int64_t ts_ms, std::string_view text) {
+        ThreadBuffer* buffer = LocalBuffer();
+        if (text.size() > kRingSize / 4) text = text.substr(0, kRingSize / 4);
+        uint32_t len = (uint32_t)text.size();
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+        if (head - tail + kHeaderSize + len > kRingSize) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        char header[kHeaderSize];
+        header[0] = (char)level;
+        std::memcpy(header + 1, &len, 4);
+        std::memcpy(header + 5, &ts_ms, 8);
+        buffer->CopyIn(head, header, kHeaderSize);
+        buffer->CopyIn(head + kHeaderSize, text.data(), len);
+        buffer->head.store(head + kHeaderSize + len, std::memory_order_release);
+    }
+
+    // 同步把所有线程的缓冲区写出去（FATAL、退出前用）
+    void Flush() {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        DrainLocked();
+    }
+};
+
+// 一条日志的正文：拼在本线程复用的字符串里，析构时交给 AsyncLogger
+class LogLine {
+private:
+    LogLevel level_;
+    LogSite& site_;
+    std::string& text_;
+
+    static std::string& Scratch() {
+        thread_local std::string text;
+        return text;
+    }
+
+public:
+    LogLine(LogLevel level, LogSite& site) : level_(level), site_(site), text_(Scratch()) {
+        text_.clear();
+    }
+
+    ~LogLine() {
+        uint32_t suppressed = site_.suppressed.exchange(0, std::memory_order_relaxed);
+        if (suppressed > 0) {
+            text_ += " (";
+            *this << suppressed;
+            text_ += " similar messages suppressed)";
+        }
+        AsyncLogger& logger = AsyncLogger::Instance();
+        logger.Submit(level_, AsyncLogger::NowMs(), text_);
+        if (level_ == LogLevel::Fatal) {
+            logger.Flush();
+            std::abort();
+        }
+    }
+
+    template <class T>
+    LogLine& operator<<(const T& v) {
+        if constexpr (std::is_same_v<T, bool>) {
+            text_ += v ? "true" : "false";
+        } else if constexpr (std::is_same_v<T, char>) {
+            text_ += v;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            char buf[32];
+            std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+            text_.append(buf, r.ptr - buf);
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            text_ += std::string_view(v);
+        } else {
+            std::ostringstream oss;
+            oss << v;
+            text_ += oss.str();
+        }
+        return *this;
+    }
+};
+
+// LOG(INFO) << "..." ；没通过级别或限流时 << 右边不求值
+// 用只执行一次的 for 而不是 if/else，if (x) LOG(INFO) << ...; else ... 这种写法不会和宏里的 else 配错；
+// 每个调用点的限流状态是宏展开处 lambda 里的 static
+#define LOG_AT_LEVEL(log_level, max_per_sec) \
+    for (LogSite* log_site_ = AsyncLogger::Instance().Admit(log_level, \
+             []() -> LogSite& { static LogSite site(max_per_sec); return site; }()); \
+         log_site_ != nullptr; log_site_ = nullptr) \
+        LogLine(log_level, *log_site_)
+
+#define LOG_EVERY(level, max_per_sec) LOG_AT_LEVEL(LOG_LEVEL_##level, max_per_sec)
+#define LOG(level) LOG_AT_LEVEL(LOG_LEVEL_##level, 20)
@@ -1,32 +1,48 @@
 #pragma once
 #include "Analyzer.h"
+#include "SegmentCache.h"
+#include "WordMiner.h"
 #include <thread>
 #include <vector>
 #include <queue>
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
+#include <functional>
+#include <bitset>
 #include <iostream>
 
 class AsyncProcessor {
 private:
     Analyzer& analyzer_; // 引用核心分析器
     int batch_size_ = 10;
+    std::unique_ptr<SegmentCache> cache_; // 分词结果缓存，为空表示关闭
+    WordMiner* miner_ = nullptr;          // 新词发现，为空表示关闭
+    std::size_t parallel_threshold_;      // 超过这个字节数的行拆段并行分词，0 表示不拆
+    std::size_t parallel_piece_bytes_;    // 拆段时每段的目标大小
     
+    // 待处理的一行和它所属的频道（为空表示只计入全局）
+    struct Task {
+        std::string line;
+        Analyzer* channel = nullptr;
+    };
+
     // --- 线程安全队列定义 ---
+    // 除了待处理的行，还放超长行拆出来的分段任务 (jobs)，空闲的 worker 优先领任务
     struct SafeQueue {
-        std::queue<std::string> q;
+        std::queue<Task> q;
+        std::deque<std::function<void()>> jobs;
         std::mutex m;
         std::condition_variable cv;
         bool stop = false;
 
-        void Push(std::string val) {
+        void Push(Task val) {
             std::unique_lock<std::mutex> lock(m);
             q.push(std::move(val));
             cv.notify_one();
         }
 
-        bool Pop(std::string& val) {
+        bool Pop(Task& val) {
             std::unique_lock<std::mutex> lock(m);
             cv.wait(lock, [this] { return !q.empty() || stop; });
             if (q.empty() && stop) return false;
@@ -35,6 +51,40 @@ private:
             return true;
         }
 
+        // 一次最多取 max_count 条，一次加锁取走一批，减少锁竞争
+        // 有分段任务时只取一个任务放进 job（vals 为空），别的 worker 正在等它
+        bool PopBatch(std::vector<Task>& vals, std::size_t max_count, std::function<void()>& job) {
+            vals.clear();
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [this] { return !q.empty() || !jobs.empty() || stop; });
+            if (!jobs.empty()) {
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                return true;
+            }
+            if (q.empty() && stop) return false;
+            while (!q.empty() && vals.size() < max_count) {
+                vals.push_back(std::move(q.front()));
+                q.pop();
+            }
+            return true;
+        }
+
+        void PushJob(std::function<void()> job) {
+            std::unique_lock<std::mutex> lock(m);
+            jobs.push_back(std::move(job));
+            cv.notify_one();
+        }
+
+        // 不等待，没有任务直接返回 false
+        bool TryPopJob(std::function<void()>& job) {
+            std::unique_lock<std::mutex> lock(m);
+            if (jobs.empty()) return false;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            return true;
+        }
+
         void Stop() {
             std::unique_lock<std::mutex> lock(m);
             stop = true;
@@ -44,79 +94,303 @@ private:
 
     std::vector<std::thread> workers_;
 
+    // --- 单个时间桶的本地计数 ---
+    // 每个不同的词分配一个本地槽位：词典词按 DictUnit 指针找槽位，不拼字符串；只有未登录词才按字符串找
+    struct LocalCounts {
+        std::unordered_map<const cppjieba::DictUnit*, uint32_t> dict_slots;
+        std::unordered_map<std::string, uint32_t> oov_slots;
+        std::vector<int> counts;                 // 槽位 -> 词频
+        std::vector<uint8_t> tags;               // 槽位 -> 词性 id（分词时随 token 带出）
+        std::unordered_map<uint64_t, int> edges; // (小槽位 << 32 | 大槽位) -> 同一行内共同出现的行数
+    };
+
+    // 一行里最多取前几个不同的词连共现边（两两相连，8 个词 28 条边）
+    static constexpr std::size_t MAX_EDGE_WORDS_PER_LINE = 8;
+
+    static uint32_t SlotOf(LocalCounts& local, const std::string& content, const cppjieba::WordToken& t) {
+        uint32_t next = (uint32_t)local.counts.size();
+        bool inserted;
+        uint32_t slot;
+        if (t.unit != nullptr) {
+            auto r = local.dict_slots.emplace(t.unit, next);
+            inserted = r.second;
+            slot = r.first->second;
+        } else {
+            auto r = local.oov_slots.emplace(cppjieba::GetStringFromToken(content, t), next);
+            inserted = r.second;
+            slot = r.first->second;
+        }
+        if (inserted) {
+            local.counts.push_back(0);
+            local.tags.push_back(t.tag_id);
+        }
+        return slot;
+    }
+
+    // 把一行的分词结果计入本地计数，并记下这一行的共现边
+    // 过滤规则：pos_filter 为空时按长度，字节数 <= 3（单个汉字、英文标点、\r \n）不计；
+    // 否则只计词性在 pos_filter 里的词（词性 id 随 token 带出，不用再查词典）
+    // 多粒度模式下的子词照常计数，但不参与共现边（它和所在的长词必然同时出现，没有信息量）
+    static void CountTokens(const std::string& content, const cppjieba::WordToken* begin,
+                            const cppjieba::WordToken* end, LocalCounts& local,
+                            std::vector<uint32_t>& line_slots, const std::bitset<256>* pos_filter) {
+        line_slots.clear();
+        for (const cppjieba::WordToken* t = begin; t != end; ++t) {
+            if (pos_filter ? !pos_filter->test(t->tag_id) : t->len <= 3) continue;
+            uint32_t slot = SlotOf(local, content, *t);
+            local.counts[slot]++;
+            if (!t->sub_word && line_slots.size() < MAX_EDGE_WORDS_PER_LINE &&
+                std::find(line_slots.begin(), line_slots.end(), slot) == line_slots.end()) {
+                line_slots.push_back(slot);
+            }
+        }
+        for (std::size_t i = 0; i < line_slots.size(); ++i) {
+            for (std::size_t j = i + 1; j < line_slots.size(); ++j) {
+                uint64_t a = std::min(line_slots[i], line_slots[j]);
+                uint64_t b = std::max(line_slots[i], line_slots[j]);
+                local.edges[(a << 32) | b]++;
+            }
+        }
+    }
+
+    // 本地缓冲区的 key：(频道, 对齐到秒的时间戳)
+    typedef std::pair<Analyzer*, long long> BufferKey;
+
+    // 把本地缓冲区提交给 Analyzer，词典词在这里才转成字符串（每个不同的词一次）
+    // dict 是切出这些 DictUnit 的词典版本；每份计数都计入全局 Analyzer，带频道的再计入频道自己的 Analyzer
+    void FlushBuffer(std::map<BufferKey, LocalCounts>& buffer, const cppjieba::DictHandle& dict) {
+        std::vector<std::string> words;
+        std::unordered_map<std::string, int> counts;
+        std::unordered_map<std::string, uint8_t> tags;
+        std::vector<WordEdge> edges;
+        for (auto& kv : buffer) {
+            LocalCounts& local = kv.second;
+            words.assign(local.counts.size(), std::string());
+            for (const auto& dc : local.dict_slots) {
+                analyzer_.GetWord(dict, dc.first, words[dc.second]);
+            }
+            for (const auto& oc : local.oov_slots) {
+                words[oc.second] = oc.first;
+            }
+
+            counts.clear();
+            tags.clear();
+            for (std::size_t slot = 0; slot < words.size(); ++slot) {
+                counts[words[slot]] += local.counts[slot];
+                tags.emplace(words[slot], local.tags[slot]);
+            }
+            Analyzer* channel = kv.first.first;
+            long long bucket_ts = kv.first.second;
+            analyzer_.IngestBatch(counts, bucket_ts, &tags);
+            if (channel) channel->IngestBatch(counts, bucket_ts, &tags);
+
+            edges.clear();
+            for (const auto& e : local.edges) {
+                edges.push_back(WordEdge{words[e.first >> 32], words[e.first & 0xffffffffu], e.second});
+            }
+            analyzer_.IngestEdges(edges, bucket_ts);
+            if (channel) channel->IngestEdges(edges, bucket_ts);
+        }
+        buffer.clear();
+    }
+
+    // 一条超长行的分段任务，由 shared_ptr 共享：发起的 worker 等到全部完成才返回，
+    // 但最后一个完成的任务在通知之后还会碰到锁和条件变量，所以它们不能放在发起方的栈上
+    struct LongLineState {
+        cppjieba::DictHandle dict;
+        std::vector<std::string> pieces;
+        std::vector<std::vector<cppjieba::WordToken>> results;
+        std::size_t remaining;
+        std::mutex m;
+        std::condition_variable done;
+    };
+
+    void CutPiece(const std::shared_ptr<LongLineState>& state, std::size_t i) {
+        thread_local cppjieba::SegmentScratch scratch;
+        thread_local std::vector<std::string> one(1);
+        thread_local std::vector<std::size_t> offsets;
+        one[0].swap(state->pieces[i]);
+        analyzer_.SplitBatch(state->dict, one, state->results[i], offsets, scratch);
+        std::lock_guard<std::mutex> lock(state->m);
+        if (--state->remaining == 0) state->done.notify_all();
+    }
+
+    // 超长行：在分隔符处切成若干段，除第一段外都丢进队列让空闲 worker 并行切，
+    // 自己切第一段后帮忙领任务，全部完成后按顺序拼回（偏移量换算回整行）
+    // 返回 false 表示切不开（没有合适的分隔符），由调用方按普通行处理
+    bool CutLongLine(const cppjieba::DictHandle& dict, const std::string& line,
+                     std::vector<cppjieba::WordToken>& tokens) {
+        std::vector<std::size_t> bounds;
+        analyzer_.FindSplitPoints(dict, line, parallel_piece_bytes_, bounds);
+        std::size_t n = bounds.size() - 1;
+        if (n < 2) return false;
+
+        auto state = std::make_shared<LongLineState>();
+        state->dict = dict;
+        state->pieces.resize(n);
+        state->results.resize(n);
+        state->remaining = n;
+        for (std::size_t i = 0; i < n; ++i) {
+            state->pieces[i].assign(line, bounds[i], bounds[i + 1] - bounds[i]);
+        }
+        for (std::size_t i = 1; i < n; ++i) {
+            queue_.PushJob([this, state, i] { CutPiece(state, i); });
+        }
+        CutPiece(state, 0);
+
+        std::function<void()> job;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(state->m);
+                if (state->remaining == 0) break;
+            }
+            if (queue_.TryPopJob(job)) {
+                job();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(state->m);
+            state->done.wait(lock, [&state] { return state->remaining == 0; });
+        }
+
+        tokens.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            for (cppjieba::WordToken t : state->results[i]) {
+                t.offset += (uint32_t)bounds[i];
+                tokens.push_back(t);
+            }
+        }
+        return true;
+    }
+
     // --- Worker 线程逻辑 ---
     void WorkerLoop() {
-        // key: 时间戳(秒级对齐), value: {单词: 词频}
+        // key: (频道, 时间戳(秒级对齐)), value: 该频道该秒内的本地计数
         // 使用 map 而不是 unordered_map 主要是为了调试方便（有序）
-        std::map<long long, std::unordered_map<std::string, int>> time_separated_buffer;
+        std::map<BufferKey, LocalCounts> time_separated_buffer;
         
         int line_count = 0;
         const int BATCH_SIZE = batch_size_; // 批处理大小
 
-        std::string line;
-        while (queue_.Pop(line)) {
-            // 1. 解析时间
-            long long ts = 0;
-            try {
-                std::string tag = ExtractTimeTag(line);
-                ts = ParseTimestamp(tag);
-            } catch(...) { continue; }
-
-            // 对齐到秒 (这一步很重要，保证同一秒的数据聚在一起)
-            long long bucket_ts = (ts / 1000) * 1000;
-
-            std::size_t pos = line.find(']');
-            if (pos == std::string::npos) continue;
-            std::string content = line.substr(pos + 1);
-
-            // 2. 并行分词
-            std::vector<std::string> words;
-            analyzer_.Split(content, words);
-
-            // 3. 聚合到本地对应的时间桶中
-            for (const auto& w : words) {
-                if (w.size() > 3 && w != "\r" && w != "\n") {
-                    time_separated_buffer[bucket_ts][w]++;
+        // 以下缓冲区整个线程生命周期内复用
+        std::vector<Task> lines;
+        std::vector<std::string> misses;          // 缓存未命中、需要真正分词的行
+        std::vector<BufferKey> miss_keys;
+        std::vector<cppjieba::WordToken> tokens;
+        std::vector<cppjieba::WordToken> cached;
+        std::vector<std::size_t> offsets;
+        std::vector<uint32_t> line_slots;
+        cppjieba::SegmentScratch scratch;
+        // 本地缓冲区里的 DictUnit 指针属于这个词典版本，提交之前一直持有，提交后才换新版本
+        cppjieba::DictHandle dict = analyzer_.AcquireDict();
+        // 按词性计数时的过滤表，跟着词典版本一起换
+        std::bitset<256> pos_bits;
+        const std::bitset<256>* pos_filter = analyzer_.GetPosFilter(dict, pos_bits) ? &pos_bits : nullptr;
+
+        std::function<void()> job;
+
+        while (queue_.PopBatch(lines, BATCH_SIZE, job)) {
+            if (job) {
+                job(); // 别的 worker 拆出来的分段任务
+                job = nullptr;
+                continue;
+            }
+            misses.clear();
+            miss_keys.clear();
+            for (auto& task : lines) {
+                std::string& line = task.line;
+                // 1. 解析时间
+                long long ts = 0;
+                try {
+                    std::string tag = ExtractTimeTag(line);
+                    ts = ParseTimestamp(tag);
+                } catch(...) { continue; }
+
+                std::size_t pos = line.find(']');
+                if (pos == std::string::npos) continue;
+                line.erase(0, pos + 1);
+
+                // 对齐到秒 (这一步很重要，保证同一秒的数据聚在一起)
+                long long bucket_ts = (ts / 1000) * 1000;
+                BufferKey key(task.channel, bucket_ts);
+
+                // 顺手交给新词发现（拿不到锁就丢，不会阻塞）
+                if (miner_) miner_->Feed(ts, line);
+
+                // 2. 先查缓存，重复的弹幕直接复用上次的分词结果
+                if (cache_ && cache_->Lookup(line, dict->version, cached)) {
+                    CountTokens(line, cached.data(), cached.data() + cached.size(),
+                                time_separated_buffer[key], line_slots, pos_filter);
+                } else if (parallel_threshold_ > 0 && line.size() >= parallel_threshold_ &&
+                           CutLongLine(dict, line, cached)) {
+                    // 超长行不走批量分词，拆段并行切，也不进缓存（缓存只收短行）
+                    CountTokens(line, cached.data(), cached.data() + cached.size(),
+                                time_separated_buffer[key], line_slots, pos_filter);
+                } else {
+                    misses.push_back(std::move(line));
+                    miss_keys.push_back(key);
                 }
+                line_count++;
             }
-            line_count++;
 
-            // 4. 批量提交
-            if (line_count >= BATCH_SIZE) {
-                // 遍历本地缓冲区的所有时间点
-                for (auto& kv : time_separated_buffer) {
-                    long long current_ts = kv.first;
-                    auto& counts = kv.second;
-                    // 调用IngestBatch
-                    analyzer_.IngestBatch(counts, current_ts);
+            // 3. 并行分词：未命中的行整批一次切完 (只拿到 DictUnit 指针/字节区间)
+            if (!misses.empty()) {
+                analyzer_.SplitBatch(dict, misses, tokens, offsets, scratch);
+
+                // 4. 聚合到本地对应的时间桶中，并写回缓存
+                for (std::size_t i = 0; i < misses.size(); ++i) {
+                    const cppjieba::WordToken* begin = tokens.data() + offsets[i];
+                    const cppjieba::WordToken* end = tokens.data() + offsets[i + 1];
+                    CountTokens(misses[i], begin, end, time_separated_buffer[miss_keys[i]],
+                                line_slots, pos_filter);
+                    if (cache_) cache_->Insert(misses[i], dict->version, begin, end);
                 }
-                
-                // 清理
-                time_separated_buffer.clear();
+            }
+
+            // 5. 批量提交
+            if (line_count >= BATCH_SIZE) {
+                FlushBuffer(time_separated_buffer, dict);
                 line_count = 0;
+                dict = analyzer_.AcquireDict();
+                pos_filter = analyzer_.GetPosFilter(dict, pos_bits) ? &pos_bits : nullptr;
             }
         }
 
-        // 5. 退出前提交剩余数据
-        for (auto& kv : time_separated_buffer) {
-            analyzer_.IngestBatch(kv.second, kv.first);
-        }
+        // 6. 退出前提交剩余数据
+        FlushBuffer(time_separated_buffer, dict);
     }
 
 public:
-    AsyncProcessor(Analyzer& analyzer, int batch_size = 10) : analyzer_(analyzer), batch_size_(batch_size) {}
+    // cache_capacity: 分词缓存最多缓存多少行，0 表示不开缓存
+    // parallel_threshold: 超过这个字节数的行拆段交给所有 worker 并行分词，0 表示不拆
+    AsyncProcessor(Analyzer& analyzer, int batch_size = 10, std::size_t cache_capacity = 1 << 16,
+                   std::size_t parallel_threshold = 16 * 1024)
+        : analyzer_(analyzer), batch_size_(batch_size),
+          parallel_threshold_(parallel_threshold),
+          parallel_piece_bytes_(std::max<std::size_t>(parallel_threshold / 4, 256)) {
+        if (cache_capacity > 0) cache_ = std::make_unique<SegmentCache>(cache_capacity);
+    }
+
+    // 分词缓存的命中率 / 淘汰次数等
+    SegmentCache::Stats GetCacheStats() const {
+        return cache_ ? cache_->GetStats() : SegmentCache::Stats{};
+    }
+
+    // 接入新词发现，需在 Start 之前调用
+    void AttachMiner(WordMiner* miner) {
+        miner_ = miner;
+    }
 
     // 启动 N 个工作线程
     void Start(int num_threads = 4) {
         for (int i = 0; i < num_threads; ++i) {
             workers_.emplace_back(&AsyncProcessor::WorkerLoop, this);
         }
-        std::cout << "[AsyncProcessor] Started " << num_threads << " worker threads." << std::endl;
+        LOG(INFO) << "[AsyncProcessor] Started " << num_threads << " worker threads.";
     }
 
-    // 接收外部输入
-    void PushTask(std::string line) {
-        queue_.Push(std::move(line));
+    // 接收外部输入；channel 是 ChannelRegistry 里的频道，为空表示只计入全局
+    void PushTask(std::string line, Analyzer* channel = nullptr) {
+        queue_.Push(Task{std::move(line), channel});
     }
 
     // 停止并等待所有任务完成
@@ -125,7 +399,7 @@ public:
         for (auto& t : workers_) {
             if (t.joinable()) t.join();
         }
-        std::cout << "[AsyncProcessor] All tasks finished." << std::endl;
+        LOG(INFO) << "[AsyncProcessor] All tasks finished.";
     }
 };
 
@@ -0,0 +1,211 @@
+/*
+    查询接口的紧凑二进制格式（给告警、下游聚合这类内部消费方用，看板仍然用 JSON）
+
+    请求带 format=binary 或 Accept: application/vnd.hotwords.binary 时返回，Content-Type 同名。
+    接口的处理函数只写一遍：BinaryWriter 和 JsonWriter 的接口相同，同一个 build 回调写成哪种格式由调用方决定。
+    编码规则（全部小端）：
+    - 对象：没有 key、没有头，字段按 JSON 里出现的顺序依次排列（顺序就是接口的定义）
+    - 数组：4 字节元素个数，后面依次是元素
+    - 字符串：varint 字节长度 + UTF-8 字节（不转义、不校验，原样拷贝）
+    - 无符号整数：LEB128 varint；有符号整数：zigzag 后再 varint
+    - 浮点数：8 字节 IEEE 754 double（不做文本转换，精度不损失）
+    - 布尔：1 字节 0/1
+    例如 /api/topk 的响应是 [u32 个数]{[varint 长度][词][zigzag count]}... 然后是 "success"
+    BinaryReader 是同样规则的解析端，内部 C++ 消费方可以直接用
+*/
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <stdexcept>
+
+enum class ResponseFormat {
+    Json,
+    Binary,
+};
+
+inline const char* BinaryContentType() {
+    return "application/vnd.hotwords.binary";
+}
+
+class BinaryWriter {
+private:
+    std::string& out_;
+    std::size_t array_starts_[64]; // 第 i 层是数组时：个数字段在 out_ 里的位置，EndArray 时回填
+    uint32_t array_counts_[64];
+    uint64_t is_array_ = 0; // 第 i 位：第 i 层容器是不是数组
+    int depth_ = 0;
+
+    // 只有直接放在数组里的值才计数，对象的字段不算
+    void CountElement() {
+        if (depth_ > 0 && (is_array_ & (1ULL << (depth_ - 1)))) ++array_counts_[depth_ - 1];
+    }
+
+    void Open(bool is_array) {
+        CountElement();
+        assert(depth_ < 64);
+        uint64_t bit = 1ULL << depth_;
+        if (is_array) {
+            is_array_ |= bit;
+            array_starts_[depth_] = out_.size();
+            array_counts_[depth_] = 0;
+            out_.append(4, '\0');
+        } else {
+            is_array_ &= ~bit;
+        }
+        ++depth_;
+    }
+
+    void PutVarint(uint64_t v) {
+        char buf[10];
+        std::size_t n = 0;
+        while (v >= 0x80) {
+            buf[n++] = (char)((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        buf[n++] = (char)v;
+        out_.append(buf, n);
+    }
+
+    void PutFixed32(std::size_t pos, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out_[pos + i] = (char)((v >> (8 * i)) & 0xFF);
+    }
+
+public:
+    // 在 out 末尾追加，不会先清空
+    explicit BinaryWriter(std::string& out) : out_(out) {
+    }
+
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    BinaryWriter& BeginObject() { Open(false); return *this; }
+    BinaryWriter& BeginArray() { Open(true); return *this; }
+
+    BinaryWriter& EndObject() {
+        assert(depth_ > 0 && !(is_array_ & (1ULL << (depth_ - 1))));
+        --depth_;
+        return *this;
+    }
+
+    BinaryWriter& EndArray() {
+        assert(depth_ > 0 && (is_array_ & (1ULL << (depth_ - 1))));
+        --depth_;
+        PutFixed32(array_starts_[depth_], array_counts_[depth_]);
+        return *this;
+    }
+
+    // 字段位置固定，key 不写
+    BinaryWriter& Key(std::string_view) {
+        return *this;
+    }
+
+    BinaryWriter& String(std::string_view s) {
+        CountElement();
+        PutVarint(s.size());
+        out_.append(s.data(), s.size());
+        return *this;
+    }
+
+    BinaryWriter& Int(long long v) {
+        CountElement();
+        PutVarint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+        return *this;
+    }
+
+    BinaryWriter& UInt(unsigned long long v) {
+        CountElement();
+        PutVarint(v);
+        return *this;
+    }
+
+    BinaryWriter& Double(double v) {
+        CountElement();
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        char buf[8];
+        for (int i = 0; i < 8; ++i) buf[i] = (char)((bits >> (8 * i)) & 0xFF);
+        out_.append(buf, 8);
+        return *this;
+    }
+
+    BinaryWriter& Bool(bool v) {
+        CountElement();
+        out_ += v ? '\1' : '\0';
+        return *this;
+    }
+
+    // 所有容器都已关闭
+    bool Complete() const {
+        return depth_ == 0;
+    }
+};
+
+// 按接口的字段顺序依次读；数据不完整时抛 std::runtime_error
+class BinaryReader {
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+
+    void Need(std::size_t n) const {
+        if ((std::size_t)(end_ - p_) < n) throw std::runtime_error("binary response truncated");
+    }
+
+public:
+    explicit BinaryReader(std::string_view data)
+        : p_((const unsigned char*)data.data()), end_((const unsigned char*)data.data() + data.size()) {
+    }
+
+    uint32_t ArraySize() {
+        Need(4);
+        uint32_t v = (uint32_t)p_[0] | ((uint32_t)p_[1] << 8) | ((uint32_t)p_[2] << 16) | ((uint32_t)p_[3] << 24);
+        p_ += 4;
+        return v;
+    }
+
+    uint64_t UInt() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            Need(1);
+            unsigned char b = *p_++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (b < 0x80) return v;
+        }
+        throw std::runtime_error("binary response varint too long");
+    }
+
+    int64_t Int() {
+        uint64_t v = UInt();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+
+    // 返回的视图指向构造时传入的数据，不拷贝
+    std::string_view String() {
+        uint64_t len = UInt();
+        Need(len);
+        std::string_view s((const char*)p_, len);
+        p_ += len;
+        return s;
+    }
+
+    double Double() {
+        Need(8);
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= (uint64_t)p_[i] << (8 * i);
+        p_ += 8;
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    bool Bool() {
+        Need(1);
+        return *p_++ != 0;
+    }
+
+    bool AtEnd() const {
+        return p_ == end_;
+    }
+};
@@ -0,0 +1,170 @@
+/*
+    按频道（直播间）分开统计：每个频道一个 Analyzer，外加一个跨频道的全局 Analyzer
+
+    几百个直播间的弹幕混在一个 Analyzer 里，Top-K 就没有意义了。这里：
+    - 所有频道共用全局 Analyzer 的 jieba（词典、HMM 模型只加载一次）和同一个 AsyncProcessor 的 worker；
+      分词也只在 worker 里做一次，频道 Analyzer 只接收统计结果
+    - 频道 Analyzer 第一次写入时创建，配置（IDF 来源、注册的窗口等）照搬全局的；
+      它只有自己的计数和历史桶，内存随这个频道出现过的词增长，和词典大小无关
+    - 每条数据都同时计入全局 Analyzer，不带频道的数据只计入全局
+    - 频道创建后不会删除，Analyzer 的地址一直有效，worker 可以直接拿指针
+    频道名只允许字母、数字、'_'、'-'，最长 64 字节；频道数有上限，防止外部输入无限制地创建
+    打开持久化后每个频道在 dir/<频道名>/ 下有自己的日志和快照（见 WriteAheadLog.h），全局打开了冷存储时
+    频道的段文件在 dir/<频道名>/cold/ 下；启动时已有的频道会先恢复
+*/
+#pragma once
+#include "Analyzer.h"
+#include "WriteAheadLog.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+
+class ChannelRegistry {
+private:
+    // analyzer 为空表示正在创建（占位，防止同名频道被创建两次）
+    struct Entry {
+        std::unique_ptr<Analyzer> analyzer;
+        std::unique_ptr<WriteAheadLog> wal;
+    };
+
+    Analyzer& global_;
+    std::size_t max_channels_;
+    mutable std::shared_mutex mutex_;
+    std::condition_variable_any created_cv_; // 占位的频道建好（或失败）时通知
+    std::unordered_map<std::string, Entry> channels_;
+    std::string data_dir_; // 为空表示不持久化
+    WalCommitter* committer_ = nullptr;
+
+    /*
+        建一个频道，不持有 mutex_：持久化打开时要从它的目录恢复（读盘、重放、fsync），
+        不能让所有频道的查询和写入都等它。data_dir_ / committer_ 在处理开始前就设好了，之后只读
+    */
+    bool Build(const std::string& name, Entry& entry) {
+        auto channel = std::make_unique<Analyzer>(global_.GetSharedJieba());
+        channel->CopyConfigFrom(global_);
+        if (!data_dir_.empty()) {
+            long long hot_ms = global_.GetHotDuration();
+            if (hot_ms >= 0) channel->EnableColdArchive(data_dir_ + "/" + name + "/cold", hot_ms);
+            auto wal = std::make_unique<WriteAheadLog>(data_dir_ + "/" + name);
+            if (!wal->Recover(*channel)) return false;
+            channel->AttachWal(wal.get());
+            committer_->Add(wal.get(), channel.get());
+            entry.wal = std::move(wal);
+        }
+        entry.analyzer = std::move(channel);
+        return true;
+    }
+
+public:
+    explicit ChannelRegistry(Analyzer& global, std::size_t max_channels = 1024)
+        : global_(global), max_channels_(max_channels) {
+    }
+
+    static bool ValidName(const std::string& name) {
+        if (name.empty() || name.size() > 64) return false;
+        for (char c : name) {
+            bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    // 打开持久化并恢复 dir 下已有的频道，需在处理开始前调用；committer 要活得比这里的频道久
+    bool EnablePersistence(const std::string& dir, WalCommitter* committer) {
+        std::unique_lock<std::shared_mutex> lock(mutex_); // 启动时调用，还没有并发的查询和写入
+        data_dir_ = dir;
+        committer_ = committer;
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            LOG(ERROR) << "[Channels] Cannot create " << dir << ": " << ec.message();
+            return false;
+        }
+        std::vector<std::string> names;
+        for (auto it = std::filesystem::directory_iterator(dir, ec);
+             !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (it->is_directory(ec) && ValidName(name) && channels_.count(name) == 0) names.push_back(name);
+        }
+        for (const auto& name : names) {
+            if (channels_.size() >= max_channels_) break;
+            Entry entry;
+            if (!Build(name, entry)) return false;
+            channels_.emplace(name, std::move(entry));
+        }
+        LOG(INFO) << "[Channels] Recovered " << names.size() << " channels from " << dir;
+        return true;
+    }
+
+    // 跨频道的全局视图
+    Analyzer& Global() {
+        return global_;
+    }
+
+    // 查询用：频道不存在（或还在创建）时返回 nullptr
+    Analyzer* Find(const std::string& name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = channels_.find(name);
+        return it == channels_.end() ? nullptr : it->second.analyzer.get();
+    }
+
+    /*
+        写入用：不存在就创建；名字不合法、频道数已满或恢复失败时返回 nullptr
+        先放一个占位再出锁创建，只有写同一个新频道的线程要等它建好
+    */
+    Analyzer* GetOrCreate(const std::string& name) {
+        if (Analyzer* channel = Find(name)) return channel;
+        if (!ValidName(name)) return nullptr;
+
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            auto it = channels_.find(name);
+            if (it != channels_.end()) {
+                created_cv_.wait(lock, [&] {
+                    auto cur = channels_.find(name);
+                    return cur == channels_.end() || cur->second.analyzer != nullptr;
+                });
+                auto cur = channels_.find(name);
+                return cur == channels_.end() ? nullptr : cur->second.analyzer.get();
+            }
+            if (channels_.size() >= max_channels_) return nullptr;
+            channels_.emplace(name, Entry());
+        }
+
+        Entry entry;
+        bool ok = Build(name, entry);
+        Analyzer* ptr = entry.analyzer.get();
+        std::size_t total;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (ok) channels_[name] = std::move(entry);
+            else channels_.erase(name);
+            total = channels_.size();
+        }
+        created_cv_.notify_all();
+        if (!ok) return nullptr;
+        LOG(INFO) << "[Channels] Created channel " << name << " (" << total << " total)";
+        return ptr;
+    }
+
+    std::vector<std::string> Names() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        std::vector<std::string> names;
+        names.reserve(channels_.size());
+        for (const auto& kv : channels_) {
+            if (kv.second.analyzer) names.push_back(kv.first);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::size_t Size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return channels_.size();
+    }
+};
@@ -0,0 +1,411 @@
+/*
+    冷存储：滑出所有窗口的时间桶写成只读的列式段文件，内存里只留热数据
+
+    窗口外的桶只有 GetTopKInTimeRange 会用，原来却一直以 unordered_map<string,int> 的形式留在内存里。
+    这里定期把它们写成段文件 cold-<序号>.seg，查询时 mmap 读取：
+    - 词典列：段内出现过的词按字典序排好，词 id 就是名次；其它列只存 id
+    - 每个时间桶一行索引 (时间, 数据偏移, 词数)，按时间有序，查询时二分定位
+    - 数据列：每个桶先是按 id 升序的词 id 差值，再是对应的词频，都用 varint（BinaryWriter.h 的编码），
+      不用通用压缩，mmap 后直接就地解码
+    - 汇总列：整段每个词的总词频，按词频降序（前 N 个就是这段的 top-N 摘要）；查询区间覆盖整段时
+      直接读汇总，不用逐桶解码
+    - 文件头里有整段的最早/最晚时间，和查询区间不相交的段直接跳过；文件末尾是整个文件的 crc32
+    段文件写好（fsync + rename）后不再修改。哪些段属于当前状态由 WAL 快照记录（见 WriteAheadLog.h），
+    恢复时不在快照里的段（写好了但快照还没来得及做）会被删掉，它们的桶还在快照和日志里
+*/
+#pragma once
+#include "BinaryWriter.h"
+#include "AsyncLogger.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <limits>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 段里的词频按 64 位累加，内存里的词频表是 int：加回去时饱和到 int 的范围，不能截断成负数
+inline int SaturatingAddCount(int base, long long delta) {
+    return (int)std::clamp<long long>((long long)base + delta, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+}
+
+class ColdSegment {
+private:
+    static constexpr char kMagic[8] = {'H', 'W', 'C', 'O', 'L', 'D', '0', '1'};
+    static constexpr std::size_t kHeaderSize = 64;
+    static constexpr std::size_t kIndexEntrySize = 24; // i64 时间 + u64 数据偏移 + u64 词数
+
+    // 文件头：[magic][i64 最早时间][i64 最晚时间][u32 桶数][u32 词数][u64 词表字节区偏移][u64 索引偏移][u64 数据偏移][u64 汇总偏移]
+    // 词表：(词数 + 1) 个 u32 偏移紧跟在文件头后面，字节区里是拼在一起的词
+    std::string name_;
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+    long long min_time_ = 0;
+    long long max_time_ = 0;
+    uint32_t bucket_count_ = 0;
+    uint32_t word_count_ = 0;
+    const char* word_offsets_ = nullptr;
+    const char* word_bytes_ = nullptr;
+    const char* index_ = nullptr;
+    const char* rows_ = nullptr;
+    std::string_view summary_;
+
+    static void Put32(std::string& out, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out += (char)((v >> (8 * i)) & 0xFF);
+    }
+
+    static void Put64(std::string& out, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out += (char)((v >> (8 * i)) & 0xFF);
+    }
+
+    static void Set64(std::string& out, std::size_t pos, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out[pos + i] = (char)((v >> (8 * i)) & 0xFF);
+    }
+
+    static uint32_t Get32(const char* p) {
+        const unsigned char* u = (const unsigned char*)p;
+        return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+    }
+
+    static uint64_t Get64(const char* p) {
+        return (uint64_t)Get32(p) | ((uint64_t)Get32(p + 4) << 32);
+    }
+
+    std::string_view Word(uint32_t id) const {
+        uint32_t begin = Get32(word_offsets_ + 4 * id);
+        uint32_t end = Get32(word_offsets_ + 4 * (id + 1));
+        return std::string_view(word_bytes_ + begin, end - begin);
+    }
+
+    long long BucketTime(uint32_t i) const {
+        return (long long)Get64(index_ + kIndexEntrySize * i);
+    }
+
+    // 校验文件头里的各个偏移，防止坏文件让后面的读越界
+    bool Parse() {
+        if (size_ < kHeaderSize + 4 || std::memcmp(base_, kMagic, sizeof(kMagic)) != 0) return false;
+        uint32_t crc = (uint32_t)crc32(0L, (const Bytef*)base_, (uInt)(size_ - 4));
+        if (crc != Get32(base_ + size_ - 4)) return false;
+        min_time_ = (long long)Get64(base_ + 8);
+        max_time_ = (long long)Get64(base_ + 16);
+        bucket_count_ = Get32(base_ + 24);
+        word_count_ = Get32(base_ + 28);
+        uint64_t bytes_at = Get64(base_ + 32);
+        uint64_t index_at = Get64(base_ + 40);
+        uint64_t rows_at = Get64(base_ + 48);
+        uint64_t summary_at = Get64(base_ + 56);
+        uint64_t end = size_ - 4;
+        if (kHeaderSize + 4 * ((uint64_t)word_count_ + 1) != bytes_at || bytes_at > index_at ||
+            index_at + kIndexEntrySize * (uint64_t)bucket_count_ != rows_at || rows_at > summary_at || summary_at > end) {
+            return false;
+        }
+        word_offsets_ = base_ + kHeaderSize;
+        word_bytes_ = base_ + bytes_at;
+        if (Get32(word_offsets_ + 4 * word_count_) != index_at - bytes_at) return false;
+        index_ = base_ + index_at;
+        rows_ = base_ + rows_at;
+        summary_ = std::string_view(base_ + summary_at, end - summary_at);
+        for (uint32_t i = 0; i < bucket_count_; ++i) {
+            if (Get64(index_ + kIndexEntrySize * i + 8) > summary_at - rows_at) return false;
+        }
+        return true;
+    }
+
+public:
+    ColdSegment() = default;
+    ColdSegment(const ColdSegment&) = delete;
+    ColdSegment& operator=(const ColdSegment&) = delete;
+
+    ~ColdSegment() {
+        if (base_ != nullptr) munmap((void*)base_, size_);
+    }
+
+    // 打开并校验段文件，失败返回空
+    static std::shared_ptr<const ColdSegment> Open(const std::string& dir, const std::string& name) {
+        std::string path = dir + "/" + name;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        void* p = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return nullptr;
+
+        auto segment = std::make_shared<ColdSegment>();
+        segment->name_ = name;
+        segment->base_ = (const char*)p;
+        segment->size_ = (std::size_t)st.st_size;
+        if (!segment->Parse()) return nullptr;
+        return segment;
+    }
+
+    // 把一组按时间有序的桶编码成段文件的内容
+    template <class Buckets>
+    static void Encode(const Buckets& buckets, std::string& out) {
+        std::vector<std::string_view> words;
+        {
+            std::unordered_set<std::string_view> seen;
+            for (const auto& bucket : buckets) {
+                for (const auto& kv : bucket.word_counts) {
+                    if (seen.insert(kv.first).second) words.push_back(kv.first);
+                }
+            }
+        }
+        std::sort(words.begin(), words.end());
+        std::unordered_map<std::string_view, uint32_t> ids;
+        ids.reserve(words.size());
+        for (uint32_t i = 0; i < words.size(); ++i) ids.emplace(words[i], i);
+
+        out.assign(kMagic, sizeof(kMagic));
+        Put64(out, buckets.empty() ? 0 : (uint64_t)buckets.front().bucket_start_time);
+        Put64(out, buckets.empty() ? 0 : (uint64_t)buckets.back().bucket_start_time);
+        Put32(out, (uint32_t)buckets.size());
+        Put32(out, (uint32_t)words.size());
+        std::size_t offsets_pos = out.size();
+        out.append(32, '\0');
+
+        uint32_t offset = 0;
+        for (std::string_view w : words) {
+            Put32(out, offset);
+            offset += (uint32_t)w.size();
+        }
+        Put32(out, offset);
+        Set64(out, offsets_pos, out.size());
+        for (std::string_view w : words) out.append(w.data(), w.size());
+
+        Set64(out, offsets_pos + 8, out.size());
+        std::size_t index_pos = out.size();
+        out.append(kIndexEntrySize * buckets.size(), '\0');
+
+        std::size_t rows_pos = out.size();
+        Set64(out, offsets_pos + 16, rows_pos);
+        std::vector<std::pair<uint32_t, int>> row;
+        std::vector<long long> totals(words.size(), 0);
+        std::size_t i = 0;
+        for (const auto& bucket : buckets) {
+            row.clear();
+            for (const auto& kv : bucket.word_counts) row.push_back({ids[kv.first], kv.second});
+            std::sort(row.begin(), row.end());
+            Set64(out, index_pos + kIndexEntrySize * i, (uint64_t)bucket.bucket_start_time);
+            Set64(out, index_pos + kIndexEntrySize * i + 8, out.size() - rows_pos);
+            Set64(out, index_pos + kIndexEntrySize * i + 16, row.size());
+            BinaryWriter w(out);
+            uint32_t prev = 0;
+            for (const auto& r : row) {
+                w.UInt(r.first - prev);
+                prev = r.first;
+            }
+            for (const auto& r : row) {
+                w.Int(r.second);
+                totals[r.first] += r.second;
+            }
+            ++i;
+        }
+
+        Set64(out, offsets_pos + 24, out.size());
+        std::vector<uint32_t> order(words.size());
+        for (uint32_t id = 0; id < order.size(); ++id) order[id] = id;
+        std::sort(order.begin(), order.end(), [&totals](uint32_t a, uint32_t b) {
+            if (totals[a] != totals[b]) return totals[a] > totals[b];
+            return a < b;
+        });
+        BinaryWriter w(out);
+        w.UInt(order.size());
+        for (uint32_t id : order) w.UInt(id).Int(totals[id]);
+        Put32(out, (uint32_t)crc32(0L, (const Bytef*)out.data(), (uInt)out.size()));
+    }
+
+    const std::string& Name() const { return name_; }
+    long long MinTime() const { return min_time_; }
+    long long MaxTime() const { return max_time_; }
+    std::size_t BucketCount() const { return bucket_count_; }
+    std::size_t FileBytes() const { return size_; }
+
+    // 整段每个词的总词频，按词频降序；f(词, 词频) 返回 false 时停止（只要 top-N 时用）
+    template <class F>
+    void ForEachTotal(F f) const {
+        BinaryReader r(summary_);
+        uint64_t n = r.UInt();
+        for (uint64_t i = 0; i < n; ++i) {
+            uint32_t id = (uint32_t)r.UInt();
+            long long total = r.Int();
+            if (id >= word_count_) return;
+            if (!f(Word(id), total)) return;
+        }
+    }
+
+    // 把 [start_ts, end_ts] 内的词频加进 out；区间覆盖整段时直接用汇总列
+    void AddRange(long long start_ts, long long end_ts, std::unordered_map<std::string, int>& out) const {
+        if (end_ts < min_time_ || start_ts > max_time_) return;
+        if (start_ts <= min_time_ && end_ts >= max_time_) {
+            ForEachTotal([&out](std::string_view word, long long total) {
+                int& c = out[std::string(word)];
+                c = SaturatingAddCount(c, total);
+                return true;
+            });
+            return;
+        }
+
+        uint32_t lo = 0, hi = bucket_count_;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (BucketTime(mid) < start_ts) lo = mid + 1;
+            else hi = mid;
+        }
+        std::vector<long long> totals(word_count_, 0);
+        std::vector<uint32_t> ids;
+        std::string_view rows(rows_, (std::size_t)(summary_.data() - rows_));
+        for (uint32_t i = lo; i < bucket_count_ && BucketTime(i) <= end_ts; ++i) {
+            uint64_t offset = Get64(index_ + kIndexEntrySize * i + 8);
+            uint64_t n = Get64(index_ + kIndexEntrySize * i + 16);
+            BinaryReader r(rows.substr(offset));
+            ids.clear();
+            uint32_t id = 0;
+            for (uint64_t j = 0; j < n; ++j) {
+                id += (uint32_t)r.UInt();
+                ids.push_back(id);
+            }
+            for (uint64_t j = 0; j < n; ++j) {
+                long long count = r.Int();
+                if (ids[j] < word_count_) totals[ids[j]] += count;
+            }
+        }
+        for (uint32_t id = 0; id < word_count_; ++id) {
+            if (totals[id] == 0) continue;
+            int& c = out[std::string(Word(id))];
+            c = SaturatingAddCount(c, totals[id]);
+        }
+    }
+};
+
+/*
+    一个 Analyzer 的所有冷段。段列表由 Analyzer 的锁保护（写时持写锁，查询持读锁拷走 shared_ptr 后出锁读）；
+    Seal 只写文件、不改列表，可以在锁外调用
+*/
+class ColdArchive {
+private:
+    std::string dir_;
+    uint64_t next_seq_ = 1;
+    std::vector<std::shared_ptr<const ColdSegment>> segments_; // 按最早时间排序
+
+    static bool ParseName(const std::string& name, uint64_t& seq) {
+        if (!name.starts_with("cold-") || !name.ends_with(".seg") || name.size() <= 9) return false;
+        std::string digits = name.substr(5, name.size() - 9);
+        if (digits.find_first_not_of("0123456789") != std::string::npos) return false;
+        seq = std::stoull(digits);
+        return true;
+    }
+
+    void SyncDir() const {
+        int dfd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dfd < 0) return;
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+
+public:
+    explicit ColdArchive(const std::string& dir) : dir_(dir) {
+    }
+
+    const std::string& Dir() const {
+        return dir_;
+    }
+
+    /*
+        启动时调用：打开 names 里的段（最近一次快照记录的），目录里其它段文件都删掉
+        打不开的段返回 false（那部分历史丢了，其余照常）
+    */
+    bool Restore(const std::vector<std::string>& names) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        segments_.clear();
+        std::unordered_set<std::string> keep(names.begin(), names.end());
+        bool ok = true;
+        for (const auto& name : names) {
+            std::shared_ptr<const ColdSegment> segment = ColdSegment::Open(dir_, name);
+            if (!segment) {
+                LOG(ERROR) << "[Cold] Cannot open segment " << dir_ << "/" << name;
+                ok = false;
+                continue;
+            }
+            segments_.push_back(std::move(segment));
+        }
+        for (auto it = std::filesystem::directory_iterator(dir_, ec);
+             !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            uint64_t seq;
+            if (ParseName(name, seq)) next_seq_ = std::max(next_seq_, seq + 1);
+            if (keep.count(name) == 0 && name.starts_with("cold-")) std::remove(it->path().c_str());
+        }
+        std::sort(segments_.begin(), segments_.end(), [](const auto& a, const auto& b) {
+            return a->MinTime() < b->MinTime();
+        });
+        return ok;
+    }
+
+    // 写一个新段文件并打开（不加入列表），失败返回空
+    template <class Buckets>
+    std::shared_ptr<const ColdSegment> Seal(const Buckets& buckets) {
+        std::string data;
+        ColdSegment::Encode(buckets, data);
+        char name[64];
+        std::snprintf(name, sizeof(name), "cold-%020llu.seg", (unsigned long long)next_seq_++);
+        std::string path = dir_ + "/" + name;
+        std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = fd >= 0;
+        const char* p = data.data();
+        std::size_t left = data.size();
+        while (ok && left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) ok = false;
+            else {
+                p += n;
+                left -= n;
+            }
+        }
+        ok = ok && ::fsync(fd) == 0;
+        if (fd >= 0) ::close(fd);
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            LOG(ERROR) << "[Cold] Write " << path << " failed: " << std::strerror(errno);
+            std::remove(tmp.c_str());
+            return nullptr;
+        }
+        SyncDir();
+        return ColdSegment::Open(dir_, name);
+    }
+
+    void Add(std::shared_ptr<const ColdSegment> segment) {
+        auto pos = std::upper_bound(segments_.begin(), segments_.end(), segment, [](const auto& a, const auto& b) {
+            return a->MinTime() < b->MinTime();
+        });
+        segments_.insert(pos, std::move(segment));
+    }
+
+    const std::vector<std::shared_ptr<const ColdSegment>>& Segments() const {
+        return segments_;
+    }
+
+    // 和 [start_ts, end_ts] 有交集的段
+    void Overlapping(long long start_ts, long long end_ts, std::vector<std::shared_ptr<const ColdSegment>>& out) const {
+        for (const auto& segment : segments_) {
+            if (segment->MinTime() > end_ts) break;
+            if (segment->MaxTime() >= start_ts) out.push_back(segment);
+        }
+    }
+};
@@ -0,0 +1,269 @@
+/*
+    窗口内的词共现图 + 增量 PageRank（TextRank）
+
+    TextRankExtractor 每句话重新建一张 std::map 图、固定迭代 10 次，只能看单句；
+    这里是整条弹幕流在滑动窗口内的一张图，回答"现在大家在聊什么"：
+    - 节点: 词，内部用整数 id，没有边且不再被任何桶引用的节点回收 id
+    - 边: 同一行里出现的两个词连一条无向边，权重 = 窗口内共同出现的行数
+    - 过期: 每秒一个桶记下加过的边，桶滑出窗口时把权重减回去
+    - 度数上限: 每个节点最多 max_degree 条边，满了就挤掉最弱的一条（新边更弱则丢弃新边）
+
+    PageRank 用 push 法增量维护，目标是 p = (1-d) + d * P^T p（和 TextRank 同一公式）：
+    - 维护估计值 x 和残差 r = (1-d) + d * P^T x - x，推一个节点: x[u] += r[u]，
+      r[v] += d * r[u] * P(u,v)，r[u] = 0；|r| 都小于 epsilon 时 x 即收敛
+    - 边权变化时节点 u 的转移概率从 P 变成 P'，只需 r[v] += d * x[u] * (P'(u,v) - P(u,v))，
+      然后只推受影响的节点，不做全量重算
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// 一条共现边的增量（由 worker 在本地按行聚合好）
+struct WordEdge {
+    std::string a;
+    std::string b;
+    int count;
+};
+
+class CooccurrenceGraph {
+private:
+    struct Node {
+        std::string word;
+        std::unordered_map<uint32_t, int> adj; // 邻居 -> 边权
+        long long strength = 0;                // 边权之和（出度权重）
+        double x = 0.0;                        // PageRank 估计值
+        double r = 0.0;                        // 残差
+        int pending = 0;                       // 还在窗口里的桶对它的引用数，为 0 且没有边时才回收
+        bool queued = false;
+        bool alive = false;
+    };
+
+    struct Delta {
+        uint32_t u;
+        uint32_t v;
+        int count;
+    };
+
+    long long window_ms_;
+    std::size_t max_degree_;
+    double damping_;
+    double epsilon_;
+    std::size_t max_pushes_;
+
+    std::mutex mutex_;
+    std::vector<Node> nodes_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<uint32_t> free_ids_;
+    std::deque<uint32_t> push_queue_;
+    std::map<long long, std::vector<Delta>> buckets_; // 秒级桶 -> 该秒加过的边
+    long long latest_time_ = 0;
+
+    uint32_t Intern(const std::string& word) {
+        auto it = ids_.find(word);
+        if (it != ids_.end()) return it->second;
+        uint32_t id;
+        if (!free_ids_.empty()) {
+            id = free_ids_.back();
+            free_ids_.pop_back();
+        } else {
+            id = (uint32_t)nodes_.size();
+            nodes_.emplace_back();
+        }
+        Node& n = nodes_[id];
+        n.word = word;
+        n.alive = true;
+        n.x = 0.0;
+        n.r = 1.0 - damping_; // 新节点带来的 (1-d) 基础分
+        Enqueue(id);
+        ids_.emplace(word, id);
+        return id;
+    }
+
+    void Release(uint32_t id) {
+        Node& n = nodes_[id];
+        ids_.erase(n.word);
+        n = Node();
+        free_ids_.push_back(id);
+    }
+
+    void Enqueue(uint32_t id) {
+        Node& n = nodes_[id];
+        if (!n.queued && std::fabs(n.r) >= epsilon_) {
+            n.queued = true;
+            push_queue_.push_back(id);
+        }
+    }
+
+    // 把节点 u 当前这一行转移概率对残差的贡献加上 (sign = 1) 或减掉 (sign = -1)
+    void ApplyRow(uint32_t u, double sign) {
+        Node& n = nodes_[u];
+        if (n.strength <= 0 || n.x == 0.0) return;
+        double scale = sign * damping_ * n.x / n.strength;
+        for (const auto& kv : n.adj) {
+            nodes_[kv.first].r += scale * kv.second;
+            Enqueue(kv.first);
+        }
+    }
+
+    void Touch(uint32_t u, std::unordered_set<uint32_t>& touched) {
+        if (touched.insert(u).second) ApplyRow(u, -1.0);
+    }
+
+    void AddWeight(uint32_t u, uint32_t v, int delta) {
+        Node& n = nodes_[u];
+        auto it = n.adj.find(v);
+        if (it == n.adj.end()) {
+            if (delta <= 0) return;
+            n.adj.emplace(v, delta);
+        } else {
+            delta = std::max(delta, -it->second);
+            it->second += delta;
+            if (it->second == 0) n.adj.erase(it);
+        }
+        n.strength += delta;
+    }
+
+    void RemoveEdge(uint32_t u, uint32_t v) {
+        auto it = nodes_[u].adj.find(v);
+        if (it == nodes_[u].adj.end()) return;
+        int weight = it->second;
+        AddWeight(u, v, -weight);
+        AddWeight(v, u, -weight);
+    }
+
+    // 节点满了：找最弱的边，比新边弱就挤掉它，否则返回 false 丢弃新边
+    bool MakeRoom(uint32_t u, int incoming, std::unordered_set<uint32_t>& touched) {
+        Node& n = nodes_[u];
+        if (n.adj.size() < max_degree_) return true;
+        auto weakest = std::min_element(n.adj.begin(), n.adj.end(),
+            [](const std::pair<const uint32_t, int>& a, const std::pair<const uint32_t, int>& b) {
+                return a.second < b.second;
+            });
+        if (weakest->second >= incoming) return false;
+        uint32_t w = weakest->first;
+        Touch(w, touched);
+        RemoveEdge(u, w);
+        return true;
+    }
+
+    // 一批边权变化：先减掉涉及节点的旧贡献，改边权，再加上新贡献，最后推残差
+    void ApplyDeltas(const std::vector<Delta>& deltas) {
+        std::unordered_set<uint32_t> touched;
+        for (const Delta& d : deltas) {
+            Touch(d.u, touched);
+            Touch(d.v, touched);
+        }
+        for (const Delta& d : deltas) {
+            if (d.count > 0 && nodes_[d.u].adj.find(d.v) == nodes_[d.u].adj.end()) {
+                if (!MakeRoom(d.u, d.count, touched) || !MakeRoom(d.v, d.count, touched)) continue;
+            }
+            AddWeight(d.u, d.v, d.count);
+            AddWeight(d.v, d.u, d.count);
+        }
+        for (uint32_t u : touched) {
+            ApplyRow(u, 1.0);
+        }
+        for (uint32_t u : touched) {
+            if (nodes_[u].adj.empty() && nodes_[u].pending == 0) Release(u);
+        }
+        Push(max_pushes_);
+    }
+
+    void Push(std::size_t limit) {
+        for (std::size_t i = 0; i < limit && !push_queue_.empty(); ++i) {
+            uint32_t u = push_queue_.front();
+            push_queue_.pop_front();
+            Node& n = nodes_[u];
+            n.queued = false;
+            if (!n.alive || std::fabs(n.r) < epsilon_) continue;
+            double r = n.r;
+            n.r = 0.0;
+            n.x += r;
+            if (n.strength <= 0) continue;
+            double scale = damping_ * r / n.strength;
+            for (const auto& kv : n.adj) {
+                nodes_[kv.first].r += scale * kv.second;
+                Enqueue(kv.first);
+            }
+        }
+    }
+
+public:
+    // window_ms: 窗口长度；max_pushes: 每批最多推多少次，剩下的留给下一批或查询时继续
+    CooccurrenceGraph(long long window_ms, std::size_t max_degree = 64, double damping = 0.85,
+                      double epsilon = 1e-4, std::size_t max_pushes = 100000)
+        : window_ms_(window_ms), max_degree_(max_degree), damping_(damping),
+          epsilon_(epsilon), max_pushes_(max_pushes) {
+    }
+
+    void AddEdges(const std::vector<WordEdge>& edges, long long timestamp) {
+        long long bucket_time = (timestamp / 1000) * 1000;
+        std::lock_guard<std::mutex> lock(mutex_);
+        latest_time_ = std::max(latest_time_, bucket_time);
+        long long expire_threshold = latest_time_ - window_ms_;
+
+        std::vector<Delta> deltas;
+        if (bucket_time >= expire_threshold && !edges.empty()) {
+            std::vector<Delta>& bucket = buckets_[bucket_time];
+            for (const WordEdge& e : edges) {
+                if (e.a == e.b || e.count <= 0) continue;
+                Delta d{Intern(e.a), Intern(e.b), e.count};
+                nodes_[d.u].pending++;
+                nodes_[d.v].pending++;
+                bucket.push_back(d);
+                deltas.push_back(d);
+            }
+        }
+
+        // 滑出窗口的桶：边权减回去
+        while (!buckets_.empty() && buckets_.begin()->first < expire_threshold) {
+            for (const Delta& d : buckets_.begin()->second) {
+                nodes_[d.u].pending--;
+                nodes_[d.v].pending--;
+                deltas.push_back(Delta{d.u, d.v, -d.count});
+            }
+            buckets_.erase(buckets_.begin());
+        }
+
+        if (!deltas.empty()) ApplyDeltas(deltas);
+    }
+
+    // 当前 PageRank 最高的 k 个词（先把残差推到收敛，通常只剩很少的节点要推）
+    std::vector<std::pair<std::string, double>> GetTopTopics(int k) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Push(max_pushes_);
+
+        std::vector<std::pair<double, uint32_t>> scored;
+        scored.reserve(ids_.size());
+        for (const auto& kv : ids_) {
+            const Node& n = nodes_[kv.second];
+            if (!n.adj.empty()) scored.push_back({n.x, kv.second});
+        }
+        k = std::max(0, std::min(k, (int)scored.size())); // k 来自 URL 参数，负数时 partial_sort 越界
+        std::partial_sort(scored.begin(), scored.begin() + k, scored.end(),
+            [this](const std::pair<double, uint32_t>& a, const std::pair<double, uint32_t>& b) {
+                if (a.first != b.first) return a.first > b.first;
+                return nodes_[a.second].word < nodes_[b.second].word;
+            });
+
+        std::vector<std::pair<std::string, double>> ans;
+        ans.reserve(k);
+        for (int i = 0; i < k; ++i) {
+            ans.push_back({nodes_[scored[i].second].word, scored[i].first});
+        }
+        return ans;
+    }
+
+    std::size_t NodeCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ids_.size();
+    }
+};
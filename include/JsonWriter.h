@@ -0,0 +1,241 @@
+/*
+    流式 JSON 输出：直接往调用方的 std::string 里追加，不建 DOM 树
+
+    crow::json::wvalue 每个元素、每个字段都要分配一个节点和一个 key 字符串，最后再遍历一遍序列化；
+    接口的响应结构都是固定的，这里按顺序直接写字节：
+    - 逗号由写入器自己管（每层记一个"是否已有元素"的位），调用方只管 Begin/Key/值/End 的顺序
+    - 输出缓冲区由调用方持有，可以跨请求复用（clear() 不释放容量），稳态下不再分配内存
+    - 小片段（逗号、引号、key、数字）先攒在写入器自己的栈上缓冲里，满了或最外层容器关闭时
+      一次性追加进输出缓冲区，避免每个字节一次 std::string::push_back
+    - 字符串按 UTF-8 校验：合法的多字节序列（中文词）原样拷贝，引号、反斜杠和控制字符转义，
+      非法字节（截断的多字节序列等）替换为 �，保证输出一定是合法 JSON
+    - 浮点数用 std::to_chars 输出最短的可往返表示，Double(v, precision) 按有效位数输出（同 printf 的 %.*g），
+      NaN / Inf 写成 null
+    嵌套深度最多 64 层（接口的响应不超过 4 层）
+*/
+#pragma once
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+
+class JsonWriter {
+private:
+    std::string& out_;
+    char buf_[512];
+    std::size_t pos_ = 0; // buf_ 里还没刷进 out_ 的字节数
+    uint64_t has_items_ = 0; // 第 i 位：第 i 层容器里是否已经写过元素
+    int depth_ = 0;
+    bool after_key_ = false; // 刚写完 key，下一个值前面不要逗号
+
+    void Put(char c) {
+        if (pos_ == sizeof(buf_)) Flush();
+        buf_[pos_++] = c;
+    }
+
+    void Put(const char* p, std::size_t n) {
+        if (n > sizeof(buf_) - pos_) {
+            Flush();
+            if (n > sizeof(buf_)) {
+                out_.append(p, n);
+                return;
+            }
+        }
+        std::memcpy(buf_ + pos_, p, n);
+        pos_ += n;
+    }
+
+    void BeforeValue() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ > 0) {
+            uint64_t bit = 1ULL << (depth_ - 1);
+            if (has_items_ & bit) Put(',');
+            has_items_ |= bit;
+        }
+    }
+
+    void Open(char c) {
+        BeforeValue();
+        assert(depth_ < 64);
+        Put(c);
+        ++depth_;
+        has_items_ &= ~(1ULL << (depth_ - 1));
+    }
+
+    void Close(char c) {
+        assert(depth_ > 0 && !after_key_);
+        --depth_;
+        Put(c);
+        if (depth_ == 0) Flush();
+    }
+
+    // 每个字节的处理方式：0 原样拷贝，1 需要转义，2/3/4 多字节序列的首字节（序列长度，要校验），5 非法字节
+    struct ByteClassTable {
+        unsigned char v[256];
+        constexpr ByteClassTable() : v() {
+            for (int c = 0; c < 0x20; ++c) v[c] = 1;
+            v[(unsigned char)'"'] = 1;
+            v[(unsigned char)'\\'] = 1;
+            for (int c = 0x80; c < 0x100; ++c) {
+                if (c >= 0xC2 && c <= 0xDF) v[c] = 2;
+                else if (c >= 0xE0 && c <= 0xEF) v[c] = 3;
+                else if (c >= 0xF0 && c <= 0xF4) v[c] = 4;
+                else v[c] = 5;
+            }
+        }
+    };
+
+    // p 开头、长度为 n 的多字节序列是否合法（不接受过长编码和代理区），调用方保证 p + n 不越界
+    static bool ValidUtf8Sequence(const unsigned char* p, unsigned n) {
+        unsigned char lo = 0x80, hi = 0xBF; // 第二个字节的合法范围
+        if (p[0] == 0xE0) lo = 0xA0;
+        else if (p[0] == 0xED) hi = 0x9F;
+        else if (p[0] == 0xF0) lo = 0x90;
+        else if (p[0] == 0xF4) hi = 0x8F;
+        if (p[1] < lo || p[1] > hi) return false;
+        for (unsigned j = 2; j < n; ++j) {
+            if ((p[j] & 0xC0) != 0x80) return false;
+        }
+        return true;
+    }
+
+    void AppendEscaped(std::string_view s) {
+        static constexpr ByteClassTable kClass;
+        static const char kHex[] = "0123456789abcdef";
+        const unsigned char* p = (const unsigned char*)s.data();
+        const unsigned char* end = p + s.size();
+        const unsigned char* run = p; // [run, p) 是不需要处理、还没拷贝的字节
+        Put('"');
+        while (p != end) {
+            unsigned k = kClass.v[*p];
+            if (k == 0) {
+                ++p;
+                continue;
+            }
+            if (k >= 2 && k <= 4 && (std::size_t)(end - p) >= k && ValidUtf8Sequence(p, k)) {
+                p += k;
+                continue;
+            }
+            Put((const char*)run, p - run);
+            unsigned char c = *p;
+            switch (c) {
+                case '"': Put("\\\"", 2); break;
+                case '\\': Put("\\\\", 2); break;
+                case '\n': Put("\\n", 2); break;
+                case '\r': Put("\\r", 2); break;
+                case '\t': Put("\\t", 2); break;
+                default:
+                    if (c < 0x20) {
+                        char buf[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                        Put(buf, 6);
+                    } else {
+                        Put("\\ufffd", 6);
+                    }
+            }
+            run = ++p;
+        }
+        Put((const char*)run, p - run);
+        Put('"');
+    }
+
+    template <class T>
+    void AppendNumber(T v) {
+        char buf[32];
+        std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+        Put(buf, r.ptr - buf);
+    }
+
+public:
+    // 在 out 末尾追加，不会先清空
+    explicit JsonWriter(std::string& out) : out_(out) {
+    }
+
+    ~JsonWriter() {
+        Flush();
+    }
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    // 把攒着的字节写进输出缓冲区；最外层容器关闭时会自动调用
+    void Flush() {
+        out_.append(buf_, pos_);
+        pos_ = 0;
+    }
+
+    JsonWriter& BeginObject() { Open('{'); return *this; }
+    JsonWriter& EndObject() { Close('}'); return *this; }
+    JsonWriter& BeginArray() { Open('['); return *this; }
+    JsonWriter& EndArray() { Close(']'); return *this; }
+
+    // 对象里的字段名；key 都是代码里的常量，但同样按字符串转义
+    JsonWriter& Key(std::string_view key) {
+        BeforeValue();
+        AppendEscaped(key);
+        Put(':');
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter& String(std::string_view s) {
+        BeforeValue();
+        AppendEscaped(s);
+        return *this;
+    }
+
+    JsonWriter& Int(long long v) {
+        BeforeValue();
+        AppendNumber(v);
+        return *this;
+    }
+
+    JsonWriter& UInt(unsigned long long v) {
+        BeforeValue();
+        AppendNumber(v);
+        return *this;
+    }
+
+    JsonWriter& Double(double v) {
+        BeforeValue();
+        if (std::isfinite(v)) AppendNumber(v);
+        else Put("null", 4);
+        return *this;
+    }
+
+    // 保留 precision 位有效数字，输出和 "%.*g" 一致
+    JsonWriter& Double(double v, int precision) {
+        BeforeValue();
+        if (std::isfinite(v)) {
+            char buf[32];
+            std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, precision);
+            Put(buf, r.ptr - buf);
+        } else {
+            Put("null", 4);
+        }
+        return *this;
+    }
+
+    JsonWriter& Bool(bool v) {
+        BeforeValue();
+        if (v) Put("true", 4);
+        else Put("false", 5);
+        return *this;
+    }
+
+    JsonWriter& Null() {
+        BeforeValue();
+        Put("null", 4);
+        return *this;
+    }
+
+    // 所有容器都已关闭
+    bool Complete() const {
+        return depth_ == 0 && !after_key_;
+    }
+};
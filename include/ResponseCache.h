@@ -0,0 +1,115 @@
+/*
+    读接口的响应缓存：存的是序列化好的 JSON 字节，不是结果对象
+
+    /api/topk、/api/history、/api/trending 每次请求都要在 Analyzer 的锁下重算、再逐个元素拼 JSON，
+    而两次请求之间往往没有新数据写入。这里按 (接口+参数, 数据版本) 缓存最终的响应体：
+    - 数据版本是 Analyzer 的提交计数，每次 IngestBatch 加一，版本不同即视为过期
+    - 命中时只是一次哈希查找 + 拷贝响应体；响应体用 shared_ptr 持有，拷出去时不持锁
+    - ETag 由版本号和 key 算出，不用看响应体，客户端带 If-None-Match 时直接回 304；
+      版本号每次启动都从 0 开始，所以 ETag 里还带一个进程纪元（启动时随机生成），
+      重启前拿到的 ETag 不会和重启后同一版本号的内容撞上
+    - 条目数超过上限时先清掉旧版本的条目，还不够就全部清空（key 的种类很少，正常不会触发）
+*/
+#pragma once
+#include <string>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <chrono>
+
+class ResponseCache {
+private:
+    struct Entry {
+        uint64_t version;
+        std::shared_ptr<const std::string> body;
+    };
+
+    std::size_t max_entries_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+
+    static std::string_view StripWeak(std::string_view tag) {
+        if (tag.starts_with("W/")) tag.remove_prefix(2);
+        return tag;
+    }
+
+public:
+    explicit ResponseCache(std::size_t max_entries = 4096) : max_entries_(max_entries) {
+    }
+
+    // 本进程的纪元：随机数和启动时间混在一起，进程内不变
+    static uint64_t Epoch() {
+        static const uint64_t epoch = []() {
+            std::random_device rd;
+            uint64_t now = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+            return ((uint64_t)rd() << 32 | rd()) ^ now;
+        }();
+        return epoch;
+    }
+
+    // 同一进程里同一个 key 在同一个数据版本下响应体不变，所以 ETag 只取决于纪元和这两者
+    static std::string MakeETag(const std::string& key, uint64_t version) {
+        char buf[80];
+        std::snprintf(buf, sizeof(buf), "\"%llx-%llx-%zx\"", (unsigned long long)Epoch(), (unsigned long long)version,
+                      std::hash<std::string>()(key));
+        return buf;
+    }
+
+    // If-None-Match 可能是逗号分隔的多个 ETag，也可能是 *。
+    // 逐个拆出来去掉空白和 W/ 前缀后整串比较（If-None-Match 用弱比较），不能用子串查找：
+    // "\"1-ab\"" 不能因为包含在 "\"1-abc\"" 里就算命中
+    static bool ETagMatches(const std::string& if_none_match, const std::string& etag) {
+        std::string_view target = StripWeak(etag);
+        std::string_view header = if_none_match;
+        std::size_t pos = 0;
+        while (pos < header.size()) {
+            std::size_t end = header.find(',', pos);
+            if (end == std::string_view::npos) end = header.size();
+            std::string_view tag = header.substr(pos, end - pos);
+            pos = end + 1;
+            while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) tag.remove_prefix(1);
+            while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) tag.remove_suffix(1);
+            if (tag == "*" || (!tag.empty() && StripWeak(tag) == target)) return true;
+        }
+        return false;
+    }
+
+    // 命中（版本一致）时返回响应体，否则返回空
+    std::shared_ptr<const std::string> Get(const std::string& key, uint64_t version) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end() || it->second.version != version) return nullptr;
+        return it->second.body;
+    }
+
+    std::shared_ptr<const std::string> Put(const std::string& key, uint64_t version, std::string body) {
+        auto ptr = std::make_shared<const std::string>(std::move(body));
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            // 并发重算时保留版本更新的那份
+            if (it->second.version <= version) it->second = Entry{version, ptr};
+            return ptr;
+        }
+        if (entries_.size() >= max_entries_) {
+            for (auto e = entries_.begin(); e != entries_.end();) {
+                if (e->second.version != version) e = entries_.erase(e);
+                else ++e;
+            }
+            if (entries_.size() >= max_entries_) entries_.clear();
+        }
+        entries_.emplace(key, Entry{version, ptr});
+        return ptr;
+    }
+
+    std::size_t Size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return entries_.size();
+    }
+};
@@ -0,0 +1,165 @@
+/*
+    分词结果缓存：直播弹幕重复率很高（"哈哈哈哈"、"666"、复制粘贴的梗），
+    同一行内容没必要每次都重新走一遍 MixSegment。
+
+    - key: 行内容的 hash，命中后还会比较原文，hash 冲突不会返回错误结果
+    - value: 该行的 WordToken 列表（DictUnit 指针 + 字节区间，区间对同样的原文同样有效）
+    - 淘汰: CLOCK（近似 LRU），每个分片一个时钟指针
+    - 并发: 按 hash 分片，每片一把锁，多个 worker 同时查询基本不会抢同一把锁
+    - 词典热更新: 每条记录带上切分时的词典版本，版本不同按未命中处理，
+      旧版本的 DictUnit 指针不会被交给持有新版本的 worker
+*/
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include "cppjieba/Jieba.hpp"
+
+class SegmentCache {
+public:
+    struct Stats {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long insertions = 0;
+        unsigned long long evictions = 0;
+        std::size_t size = 0;       // 当前缓存的行数
+        std::size_t capacity = 0;   // 最多缓存的行数
+        double hit_rate = 0.0;
+    };
+
+private:
+    static constexpr std::size_t SHARD_COUNT = 16;
+
+    struct Entry {
+        std::size_t hash = 0;
+        uint64_t dict_version = 0;
+        std::string line;
+        std::vector<cppjieba::WordToken> tokens;
+        bool referenced = false; // CLOCK 的访问位
+        bool used = false;
+    };
+
+    struct Shard {
+        std::mutex m;
+        std::vector<Entry> slots;
+        std::unordered_map<std::size_t, std::size_t> index; // hash -> 槽位
+        std::size_t hand = 0;   // 时钟指针
+        std::size_t used = 0;   // 已占用的槽位数
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t capacity_;
+    std::size_t max_line_bytes_;
+
+    std::atomic<unsigned long long> hits_{0};
+    std::atomic<unsigned long long> misses_{0};
+    std::atomic<unsigned long long> insertions_{0};
+    std::atomic<unsigned long long> evictions_{0};
+
+    Shard& ShardOf(std::size_t hash) {
+        return shards_[hash % SHARD_COUNT];
+    }
+
+    // CLOCK：跳过最近访问过的槽位（顺便清掉访问位），找到第一个没被访问过的
+    static std::size_t FindVictim(Shard& shard) {
+        while (true) {
+            Entry& e = shard.slots[shard.hand];
+            std::size_t slot = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.slots.size();
+            if (!e.used || !e.referenced) return slot;
+            e.referenced = false;
+        }
+    }
+
+public:
+    // capacity: 最多缓存多少行；max_line_bytes: 超过这个长度的行不缓存（长文本几乎不会重复）
+    explicit SegmentCache(std::size_t capacity, std::size_t max_line_bytes = 256)
+        : shards_(new Shard[SHARD_COUNT]),
+          capacity_(std::max<std::size_t>(capacity, SHARD_COUNT)),
+          max_line_bytes_(max_line_bytes) {
+        for (std::size_t i = 0; i < SHARD_COUNT; ++i) {
+            shards_[i].slots.resize(capacity_ / SHARD_COUNT);
+        }
+    }
+
+    bool Cacheable(const std::string& line) const {
+        return !line.empty() && line.size() <= max_line_bytes_;
+    }
+
+    // 命中时把缓存的 token 拷到 tokens 并返回 true；dict_version 是调用方当前持有的词典版本
+    bool Lookup(const std::string& line, uint64_t dict_version, std::vector<cppjieba::WordToken>& tokens) {
+        if (!Cacheable(line)) return false;
+        std::size_t hash = std::hash<std::string_view>()(line);
+        Shard& shard = ShardOf(hash);
+        {
+            std::lock_guard<std::mutex> lock(shard.m);
+            auto it = shard.index.find(hash);
+            if (it != shard.index.end()) {
+                Entry& e = shard.slots[it->second];
+                if (e.dict_version == dict_version && e.line == line) {
+                    e.referenced = true;
+                    tokens.assign(e.tokens.begin(), e.tokens.end());
+                    hits_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void Insert(const std::string& line, uint64_t dict_version, const cppjieba::WordToken* begin, const cppjieba::WordToken* end) {
+        if (!Cacheable(line)) return;
+        std::size_t hash = std::hash<std::string_view>()(line);
+        Shard& shard = ShardOf(hash);
+        std::lock_guard<std::mutex> lock(shard.m);
+
+        // 别的 worker 可能刚插入了同一行（或 hash 相同的另一行）：原地覆盖
+        auto it = shard.index.find(hash);
+        std::size_t slot;
+        if (it != shard.index.end()) {
+            slot = it->second;
+        } else {
+            slot = FindVictim(shard);
+            Entry& victim = shard.slots[slot];
+            if (victim.used) {
+                shard.index.erase(victim.hash);
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                shard.used++;
+            }
+            shard.index[hash] = slot;
+        }
+
+        Entry& e = shard.slots[slot];
+        e.hash = hash;
+        e.dict_version = dict_version;
+        e.line = line;
+        e.tokens.assign(begin, end);
+        e.referenced = false;
+        e.used = true;
+        insertions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats GetStats() const {
+        Stats s;
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.insertions = insertions_.load(std::memory_order_relaxed);
+        s.evictions = evictions_.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < SHARD_COUNT; ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].m);
+            s.size += shards_[i].used;
+        }
+        s.capacity = (capacity_ / SHARD_COUNT) * SHARD_COUNT;
+        unsigned long long total = s.hits + s.misses;
+        s.hit_rate = total ? (double)s.hits / total : 0.0;
+        return s;
+    }
+};
@@ -0,0 +1,314 @@
+/*
+    看板静态资源的内存缓存（STATIC_ROOT 下的 dist 包）
+
+    原来每个请求都要 exists / is_regular_file、ifstream 打开、经 ostringstream 拷一遍，还打两行日志；
+    dist 里有一个 1.7MB 的 JS、800KB 的 CSS 和 4 种格式的图标字体。这里启动时一次性读进内存：
+    - 每个文件预先算好 gzip / brotli 压缩后的内容（压缩后不够小、或者本身就是压缩格式的不存），
+      按请求的 Accept-Encoding 挑最小的那份，不在请求路径上压缩
+    - ETag 由内容算出，每种编码各一个（br / gzip 在原始 ETag 后加后缀，三份字节不同，强 ETag 不能共用），
+      响应带 Vary: Accept-Encoding；带 If-None-Match 且和选中那份一致时回 304
+    - /assets/ 下的文件名带内容哈希（vite 打包），给一年的 immutable 缓存；index.html 等每次都要验证
+    - 整张表是不可变的快照，读者无锁拿 shared_ptr；Watch() 打开后用 inotify 监视目录，
+      文件变化后重新加载整张表再原子替换（重新部署前端不用重启服务）
+*/
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <zlib.h>
+#ifdef HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include "AsyncLogger.h"
+
+struct StaticAsset {
+    std::string content_type;
+    std::string etag;   // 原样返回时的 ETag
+    std::string cache_control;
+    std::string body;
+    std::string gzip;   // 为空表示不提供这种编码
+    std::string brotli;
+    std::string gzip_etag;
+    std::string brotli_etag;
+};
+
+class StaticAssets {
+public:
+    typedef std::unordered_map<std::string, StaticAsset> AssetMap; // key 是 URL 路径，如 /assets/index.js
+
+    // 选中的一份响应体，指向快照里的数据（调用方持有 snapshot 期间有效）
+    struct Selected {
+        const StaticAsset* asset = nullptr;
+        const std::string* body = nullptr;
+        const char* encoding = nullptr; // "br" / "gzip"，原样返回时为空
+        const std::string* etag = nullptr; // 和 body 对应的那个 ETag
+    };
+
+private:
+    std::string root_;
+    std::atomic<std::shared_ptr<const AssetMap>> live_;
+    std::thread watcher_;
+    std::atomic<bool> stop_{false};
+
+    static std::string MimeType(const std::string& path) {
+        if (path.ends_with(".html")) return "text/html";
+        if (path.ends_with(".js"))   return "application/javascript";
+        if (path.ends_with(".css"))  return "text/css";
+        if (path.ends_with(".png"))  return "image/png";
+        if (path.ends_with(".jpg") || path.ends_with(".jpeg")) return "image/jpeg";
+        if (path.ends_with(".svg"))  return "image/svg+xml";
+        if (path.ends_with(".ico"))  return "image/x-icon";
+        if (path.ends_with(".json")) return "application/json";
+        if (path.ends_with(".woff2")) return "font/woff2";
+        if (path.ends_with(".woff"))  return "font/woff";
+        if (path.ends_with(".ttf"))   return "font/ttf";
+        if (path.ends_with(".eot"))   return "application/vnd.ms-fontobject";
+        return "application/octet-stream";
+    }
+
+    // 本身已经压缩过的格式，再压一遍只会白花 CPU
+    static bool AlreadyCompressed(const std::string& path) {
+        return path.ends_with(".woff2") || path.ends_with(".woff") || path.ends_with(".png") ||
+               path.ends_with(".jpg") || path.ends_with(".jpeg") || path.ends_with(".gz") || path.ends_with(".br");
+    }
+
+    static std::string Gzip(const std::string& data) {
+        z_stream zs{};
+        // windowBits 15 + 16：带 gzip 头
+        if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) return "";
+        std::string out(deflateBound(&zs, data.size()), '\0');
+        zs.next_in = (Bytef*)data.data();
+        zs.avail_in = (uInt)data.size();
+        zs.next_out = (Bytef*)out.data();
+        zs.avail_out = (uInt)out.size();
+        int ret = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return ret == Z_STREAM_END ? out : "";
+    }
+
+    static std::string Brotli(const std::string& data) {
+#ifdef HAS_BROTLI
+        // 质量 10/11 对这几 MB 的包要十几秒（启动和每次重载都要等），只比 9 小 5~10%
+        const int quality = 9;
+        std::string out(BrotliEncoderMaxCompressedSize(data.size()), '\0');
+        std::size_t size = out.size();
+        if (out.empty() || !BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                                                  data.size(), (const uint8_t*)data.data(), &size, (uint8_t*)out.data())) {
+            return "";
+        }
+        out.resize(size);
+        return out;
+#else
+        (void)data;
+        return "";
+#endif
+    }
+
+    // 压缩后至少小 10% 才值得让客户端多解一次压缩
+    static void KeepIfSmaller(std::string& compressed, std::size_t original) {
+        if (compressed.size() * 10 > original * 9) compressed.clear();
+    }
+
+    static std::string MakeETag(const std::string& body) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "\"%zx-%zx\"", body.size(), std::hash<std::string>()(body));
+        return buf;
+    }
+
+    static std::string_view Trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    static bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (std::size_t i = 0; i < a.size(); i++) {
+            if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+        }
+        return true;
+    }
+
+    // 一项 "gzip;q=0.5" 的 q 值，没写 q 时为 1
+    static double QValue(std::string_view params) {
+        std::size_t pos = 0;
+        while (pos < params.size()) {
+            std::size_t end = params.find(';', pos);
+            if (end == std::string_view::npos) end = params.size();
+            std::string_view param = Trim(params.substr(pos, end - pos));
+            pos = end + 1;
+            if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                return std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+            }
+        }
+        return 1;
+    }
+
+    // Accept-Encoding 里是否接受 name：看完整个头，明确写了 name 的以它的 q 为准（name;q=0 即使有 * 也不接受），
+    // 没写 name 才看 *；q=0 视为不接受
+    static bool AcceptsEncoding(std::string_view header, std::string_view name) {
+        double name_q = -1, star_q = -1;
+        std::size_t pos = 0;
+        while (pos < header.size()) {
+            std::size_t end = header.find(',', pos);
+            if (end == std::string_view::npos) end = header.size();
+            std::string_view item = header.substr(pos, end - pos);
+            pos = end + 1;
+            std::size_t semi = item.find(';');
+            std::string_view token = Trim(item.substr(0, semi));
+            double q = semi == std::string_view::npos ? 1 : QValue(item.substr(semi + 1));
+            if (EqualsIgnoreCase(token, name)) {
+                name_q = std::max(name_q, q);
+            } else if (token == "*") {
+                star_q = std::max(star_q, q);
+            }
+        }
+        return (name_q >= 0 ? name_q : star_q) > 0;
+    }
+
+    std::shared_ptr<const AssetMap> LoadAll() const {
+        std::shared_ptr<AssetMap> assets = std::make_shared<AssetMap>();
+        std::error_code ec;
+        if (!std::filesystem::is_directory(root_, ec)) return assets;
+        for (auto it = std::filesystem::recursive_directory_iterator(root_, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file(ec)) continue;
+            std::ifstream ifs(it->path(), std::ios::binary); // 必须以二进制模式打开，否则图片/字体会损坏
+            if (!ifs.is_open()) continue;
+            std::ostringstream oss;
+            oss << ifs.rdbuf();
+
+            std::string url = "/" + std::filesystem::relative(it->path(), root_, ec).generic_string();
+            StaticAsset asset;
+            asset.content_type = MimeType(url);
+            asset.body = oss.str();
+            asset.etag = MakeETag(asset.body);
+            asset.cache_control = url.starts_with("/assets/") ? "public, max-age=31536000, immutable" : "no-cache";
+            if (!AlreadyCompressed(url)) {
+                asset.gzip = Gzip(asset.body);
+                KeepIfSmaller(asset.gzip, asset.body.size());
+                asset.brotli = Brotli(asset.body);
+                KeepIfSmaller(asset.brotli, asset.body.size());
+            }
+            // 同一内容的三种编码：ETag 加后缀区分，内容变了原始 ETag 跟着变，后缀的也就变了
+            std::string_view base(asset.etag.data(), asset.etag.size() - 1); // 去掉结尾的引号
+            if (!asset.gzip.empty()) asset.gzip_etag = std::string(base) + "-gz\"";
+            if (!asset.brotli.empty()) asset.brotli_etag = std::string(base) + "-br\"";
+            (*assets)[url] = std::move(asset);
+        }
+        return assets;
+    }
+
+    void WatchLoop() {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return;
+        const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+        auto add_watches = [&]() {
+            std::error_code ec;
+            inotify_add_watch(fd, root_.c_str(), mask);
+            for (auto it = std::filesystem::recursive_directory_iterator(root_, ec);
+                 !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+                if (it->is_directory(ec)) inotify_add_watch(fd, it->path().c_str(), mask);
+            }
+        };
+        add_watches();
+
+        char buf[4096];
+        bool dirty = false;
+        while (!stop_.load(std::memory_order_relaxed)) {
+            pollfd pfd{fd, POLLIN, 0};
+            // 有事件后再等一个静默期才重载，部署时一次拷很多文件只重载一次
+            int ready = poll(&pfd, 1, dirty ? 300 : 500);
+            if (ready > 0) {
+                while (read(fd, buf, sizeof(buf)) > 0) {
+                }
+                dirty = true;
+                continue;
+            }
+            if (ready == 0 && dirty) {
+                dirty = false;
+                add_watches(); // 新建的子目录也要监视（重复添加同一目录是无害的）
+                Reload();
+            }
+        }
+        close(fd);
+    }
+
+public:
+    explicit StaticAssets(const std::string& root) : root_(root) {
+        live_.store(LoadAll(), std::memory_order_release);
+    }
+
+    ~StaticAssets() {
+        StopWatching();
+    }
+
+    std::shared_ptr<const AssetMap> Snapshot() const {
+        return live_.load(std::memory_order_acquire);
+    }
+
+    void Reload() {
+        std::shared_ptr<const AssetMap> assets = LoadAll();
+        std::size_t files = assets->size();
+        live_.store(std::move(assets), std::memory_order_release);
+        LOG(INFO) << "[Static] Reloaded " << files << " files from " << root_;
+    }
+
+    // 目录变化时自动 Reload
+    void Watch() {
+        if (watcher_.joinable()) return;
+        stop_ = false;
+        watcher_ = std::thread(&StaticAssets::WatchLoop, this);
+    }
+
+    void StopWatching() {
+        stop_ = true;
+        if (watcher_.joinable()) watcher_.join();
+    }
+
+    // 按 Accept-Encoding 选出最小的那份；path 不存在时 asset 为空
+    static Selected Select(const AssetMap& assets, const std::string& path, std::string_view accept_encoding) {
+        Selected selected;
+        auto it = assets.find(path);
+        if (it == assets.end()) return selected;
+        const StaticAsset& asset = it->second;
+        selected.asset = &asset;
+        selected.body = &asset.body;
+        selected.etag = &asset.etag;
+        if (!asset.brotli.empty() && AcceptsEncoding(accept_encoding, "br")) {
+            selected.body = &asset.brotli;
+            selected.encoding = "br";
+            selected.etag = &asset.brotli_etag;
+        } else if (!asset.gzip.empty() && AcceptsEncoding(accept_encoding, "gzip")) {
+            selected.body = &asset.gzip;
+            selected.encoding = "gzip";
+            selected.etag = &asset.gzip_etag;
+        }
+        return selected;
+    }
+
+    // 所有文件原始大小和预压缩后占用的内存
+    static std::size_t MemoryBytes(const AssetMap& assets) {
+        std::size_t bytes = 0;
+        for (const auto& kv : assets) {
+            bytes += kv.second.body.size() + kv.second.gzip.size() + kv.second.brotli.size();
+        }
+        return bytes;
+    }
+};
@@ -0,0 +1,184 @@
+/*
+    可替换的分词后端（Analyzer::Split / SplitBatch 背后的实现）
+
+    - Mix:        完整的 jieba（MP + HMM），默认
+    - MP:         只走词典 DAG，不跑 HMM（有些弹幕源用不到新词识别）
+    - Whitespace: 按空白和 ASCII 标点切，压测聚合层用，几乎不花时间
+    - CharBigram: 相邻两个字一组，同样用于压测，词的数量和分布更接近中文弹幕
+
+    所有后端都先按 jieba 的分隔符切段（和 MixSegment 的 PreFilter 一致），
+    所以超长行在分隔符处拆段并行分词时结果不变；假分词切出的串也查一次词典（和 Segmenter::Push 一样），
+    词典里的词带上 DictUnit，停用词过滤和词性都和 jieba 后端一致
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cctype>
+#include "cppjieba/Jieba.hpp"
+
+enum class TokenizerKind {
+    Mix,
+    MP,
+    Whitespace,
+    CharBigram,
+};
+
+class Tokenizer {
+public:
+    virtual ~Tokenizer() {}
+
+    virtual const char* Name() const = 0;
+
+    // sentences[i] 的结果为 tokens[offsets[i], offsets[i+1])；dict 是调用方固定住的词典版本
+    // drop_stop_words 时停用词在产生 token 时就被去掉
+    virtual void CutBatch(const cppjieba::DictHandle& dict, const std::vector<std::string>& sentences,
+                          std::vector<cppjieba::WordToken>& tokens, std::vector<std::size_t>& offsets,
+                          cppjieba::SegmentScratch& scratch, bool drop_stop_words) const = 0;
+};
+
+// jieba 后端：HMM 开关在编译期确定，其余配置每批选一次 Segmenter 实例
+template <class HmmPolicy>
+class JiebaTokenizer : public Tokenizer {
+private:
+    const char* name_;
+    bool multi_granularity_;
+
+public:
+    JiebaTokenizer(const char* name, bool multi_granularity)
+        : name_(name), multi_granularity_(multi_granularity) {
+    }
+
+    const char* Name() const override {
+        return name_;
+    }
+
+    void CutBatch(const cppjieba::DictHandle& dict, const std::vector<std::string>& sentences,
+                  std::vector<cppjieba::WordToken>& tokens, std::vector<std::size_t>& offsets,
+                  cppjieba::SegmentScratch& scratch, bool drop_stop_words) const override {
+        const cppjieba::MixSegment& seg = dict->mix_seg;
+        if (!drop_stop_words) {
+            seg.GetSegmenter<HmmPolicy, cppjieba::KeepAll, cppjieba::CoarseWords>()
+                .CutBatch(sentences, tokens, offsets, scratch);
+        } else if (multi_granularity_) {
+            seg.GetSegmenter<HmmPolicy, cppjieba::DropStopWords, cppjieba::WithSubWords>()
+                .CutBatch(sentences, tokens, offsets, scratch);
+        } else {
+            seg.GetSegmenter<HmmPolicy, cppjieba::DropStopWords, cppjieba::CoarseWords>()
+                .CutBatch(sentences, tokens, offsets, scratch);
+        }
+    }
+};
+
+// 假分词的公共部分：先按分隔符切段，段内再在空白和 ASCII 标点处断开（断开处不产生 token），
+// 剩下的每一串连续字符交给子类切；token 词性按 PosTagger 的特殊规则给（m/eng/x）
+class MockTokenizer : public Tokenizer {
+protected:
+    typedef cppjieba::RuneStrArray::const_iterator RuneIter;
+
+    static bool IsBreak(cppjieba::Rune r) {
+        return r < 0x80 && (std::isspace((int)r) || std::ispunct((int)r));
+    }
+
+    // 词典里的停用词（的、了、我们…）只在 DictUnit 上打了标记，不在 IsStopWord 查的那两个集合里，
+    // 所以要先查出 DictUnit 再判断
+    static void Push(const cppjieba::DictTrie* trie, const std::string& sentence, RuneIter left, RuneIter right,
+                     bool drop_stop_words, std::vector<cppjieba::WordToken>& tokens) {
+        const cppjieba::DictUnit* unit = trie->Find(left, right + 1);
+        uint32_t len = right->offset - left->offset + right->len;
+        uint8_t tag_id = (unit != NULL && unit->tag_id != 0) ? unit->tag_id
+            : trie->SpecialTagId(cppjieba::PosTagger::SpecialRule(left, right + 1));
+        cppjieba::WordToken token(unit, left->offset, len, tag_id);
+        if (!drop_stop_words || !trie->IsStopWord(sentence, token)) {
+            tokens.push_back(token);
+        }
+    }
+
+    // [begin, end) 是一串不含断开字符的连续字符，非空
+    virtual void CutRun(const cppjieba::DictTrie* trie, const std::string& sentence, RuneIter begin, RuneIter end,
+                        bool drop_stop_words, std::vector<cppjieba::WordToken>& tokens) const = 0;
+
+public:
+    void CutBatch(const cppjieba::DictHandle& dict, const std::vector<std::string>& sentences,
+                  std::vector<cppjieba::WordToken>& tokens, std::vector<std::size_t>& offsets,
+                  cppjieba::SegmentScratch& scratch, bool drop_stop_words) const override {
+        const cppjieba::DictTrie* trie = dict->trie.get();
+        tokens.clear();
+        offsets.clear();
+        offsets.reserve(sentences.size() + 1);
+        offsets.push_back(0);
+        for (const std::string& sentence : sentences) {
+            cppjieba::PreFilter pre_filter(dict->mix_seg.GetSeparators(), sentence, scratch.runes);
+            while (pre_filter.HasNext()) {
+                cppjieba::PreFilter::Range range = pre_filter.Next();
+                RuneIter run_begin = range.begin;
+                for (RuneIter it = range.begin; ; ++it) {
+                    bool at_end = (it == range.end);
+                    if (!at_end && !IsBreak(it->rune)) continue;
+                    if (it != run_begin) CutRun(trie, sentence, run_begin, it, drop_stop_words, tokens);
+                    if (at_end) break;
+                    run_begin = it + 1;
+                }
+            }
+            offsets.push_back(tokens.size());
+        }
+    }
+};
+
+// 每一串连续字符就是一个 token
+class WhitespaceTokenizer : public MockTokenizer {
+protected:
+    void CutRun(const cppjieba::DictTrie* trie, const std::string& sentence, RuneIter begin, RuneIter end,
+                bool drop_stop_words, std::vector<cppjieba::WordToken>& tokens) const override {
+        Push(trie, sentence, begin, end - 1, drop_stop_words, tokens);
+    }
+
+public:
+    const char* Name() const override {
+        return "whitespace";
+    }
+};
+
+// 相邻两个字一组（"主播好强" -> 主播 播好 好强），只有一个字时就输出这个字
+class CharBigramTokenizer : public MockTokenizer {
+protected:
+    void CutRun(const cppjieba::DictTrie* trie, const std::string& sentence, RuneIter begin, RuneIter end,
+                bool drop_stop_words, std::vector<cppjieba::WordToken>& tokens) const override {
+        if (end - begin == 1) {
+            Push(trie, sentence, begin, begin, drop_stop_words, tokens);
+            return;
+        }
+        for (RuneIter it = begin; it + 1 != end; ++it) {
+            Push(trie, sentence, it, it + 1, drop_stop_words, tokens);
+        }
+    }
+
+public:
+    const char* Name() const override {
+        return "bigram";
+    }
+};
+
+inline std::unique_ptr<Tokenizer> MakeTokenizer(TokenizerKind kind, bool multi_granularity) {
+    switch (kind) {
+        case TokenizerKind::MP:
+            return std::unique_ptr<Tokenizer>(new JiebaTokenizer<cppjieba::NoHmm>("mp", multi_granularity));
+        case TokenizerKind::Whitespace:
+            return std::unique_ptr<Tokenizer>(new WhitespaceTokenizer());
+        case TokenizerKind::CharBigram:
+            return std::unique_ptr<Tokenizer>(new CharBigramTokenizer());
+        case TokenizerKind::Mix:
+        default:
+            return std::unique_ptr<Tokenizer>(new JiebaTokenizer<cppjieba::WithHmm>("mix", multi_granularity));
+    }
+}
+
+// 命令行 / 配置里的名字：mix | mp | whitespace | bigram
+inline bool ParseTokenizerKind(const std::string& name, TokenizerKind& kind) {
+    if (name == "mix") kind = TokenizerKind::Mix;
+    else if (name == "mp") kind = TokenizerKind::MP;
+    else if (name == "whitespace") kind = TokenizerKind::Whitespace;
+    else if (name == "bigram") kind = TokenizerKind::CharBigram;
+    else return false;
+    return true;
+}
@@ -0,0 +1,194 @@
+/*
+    Top-K / 趋势推送（WebSocket /api/stream），代替看板每秒轮询 /api/topk 和 /api/trending
+
+    轮询时每个打开的看板每秒发两个 GET，每个都在 Analyzer 的锁下重算一遍，开销随看板数量线性增长；
+    这里每个 tick 只算一次、序列化一次，同一个字符串发给所有订阅者：
+    - 新订阅者：立刻收到完整快照 {"type":"snapshot","topk":[...],"trending":[...]}
+    - 之后每个 tick：只发和上一个 tick 相比变了的名次
+      {"type":"diff","topk":{"size":N,"changes":[{"rank":i,"word":..,"count":..}]},"trending":[...]}
+      trending 只有 k 个，变了就整个发，没变就不带；什么都没变就不发
+    - 没有订阅者、或者上个 tick 以来没有新数据写入（数据版本没变）时不计算
+    发送回调只是把消息交给网络线程（crow 的 send_text），持锁调用，退订返回后不会再被调用
+*/
+#pragma once
+#include "Analyzer.h"
+#include "JsonWriter.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// 趋势方向标签，和 /api/trending 一致
+inline const char* TrendTag(double slope) {
+    if (slope > 1.0) return "rising";
+    if (slope < -1.0) return "falling";
+    return "stable";
+}
+
+class TopKStream {
+public:
+    typedef std::function<void(const std::string&)> Sender;
+
+private:
+    Analyzer& analyzer_;
+    int k_;
+    int trend_k_;
+    int trend_threshold_;
+    int interval_ms_;
+
+    std::mutex mutex_;
+    std::map<const void*, Sender> subscribers_;
+    std::vector<std::pair<std::string, int>> last_topk_;
+    std::vector<TrendItem> last_trending_;
+    bool has_last_ = false; // last_* 是否是最近一个 tick 的结果（没人订阅时停算，基线就过期了）
+    uint64_t last_version_ = 0; // 算 last_* 时 Analyzer 的数据版本，没变就不用重算
+
+    std::thread thread_;
+    std::condition_variable wake_cv_;
+    bool stop_ = false;
+
+    static void WriteTrending(JsonWriter& w, const std::vector<TrendItem>& trends) {
+        w.BeginArray();
+        for (std::size_t i = 0; i < trends.size(); ++i) {
+            w.BeginObject()
+                .Key("word").String(trends[i].word)
+                .Key("slope").Double(trends[i].slope, 6) // 和改用 JsonWriter 之前的 %.6g 一样
+                .Key("count").Int(trends[i].total_count)
+                .Key("tag").String(TrendTag(trends[i].slope))
+                .EndObject();
+        }
+        w.EndArray();
+    }
+
+    static bool SameTrending(const std::vector<TrendItem>& a, const std::vector<TrendItem>& b) {
+        if (a.size() != b.size()) return false;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            if (a[i].word != b[i].word || a[i].slope != b[i].slope || a[i].total_count != b[i].total_count) return false;
+        }
+        return true;
+    }
+
+    std::string Snapshot() const {
+        std::string out;
+        JsonWriter w(out);
+        w.BeginObject().Key("type").String("snapshot").Key("topk").BeginArray();
+        for (std::size_t i = 0; i < last_topk_.size(); ++i) {
+            w.BeginObject().Key("word").String(last_topk_[i].first).Key("count").Int(last_topk_[i].second).EndObject();
+        }
+        w.EndArray().Key("trending");
+        WriteTrending(w, last_trending_);
+        w.EndObject();
+        return out;
+    }
+
+    // 重新计算，返回要广播的 diff（没有变化时为空）；调用方持有 mutex_
+    std::string Refresh() {
+        last_version_ = analyzer_.GetDataVersion();
+        std::vector<std::pair<std::string, int>> topk = analyzer_.GetLast10MinTopK(k_);
+        std::vector<TrendItem> trending = analyzer_.GetTrending(trend_k_, trend_threshold_);
+
+        std::vector<std::size_t> changed; // 名次变了的位置
+        for (std::size_t i = 0; i < topk.size(); ++i) {
+            if (i < last_topk_.size() && last_topk_[i] == topk[i]) continue;
+            changed.push_back(i);
+        }
+        bool topk_changed = !changed.empty() || topk.size() != last_topk_.size();
+        bool trending_changed = !SameTrending(trending, last_trending_);
+
+        std::string diff;
+        if (topk_changed || trending_changed) {
+            JsonWriter w(diff);
+            w.BeginObject().Key("type").String("diff");
+            if (topk_changed) {
+                w.Key("topk").BeginObject().Key("size").UInt(topk.size()).Key("changes").BeginArray();
+                for (std::size_t i : changed) {
+                    w.BeginObject()
+                        .Key("rank").UInt(i)
+                        .Key("word").String(topk[i].first)
+                        .Key("count").Int(topk[i].second)
+                        .EndObject();
+                }
+                w.EndArray().EndObject();
+            }
+            if (trending_changed) {
+                w.Key("trending");
+                WriteTrending(w, trending);
+            }
+            w.EndObject();
+        }
+        last_topk_.swap(topk);
+        last_trending_.swap(trending);
+        has_last_ = true;
+        return diff;
+    }
+
+    void Tick() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (subscribers_.empty()) {
+            has_last_ = false;
+            return;
+        }
+        if (analyzer_.GetDataVersion() == last_version_) return;
+        std::string diff = Refresh();
+        if (diff.empty()) return;
+        for (auto& kv : subscribers_) {
+            kv.second(diff);
+        }
+    }
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return stop_; });
+            if (stop_) break;
+            lock.unlock();
+            Tick();
+            lock.lock();
+        }
+    }
+
+public:
+    // k: 推送的 TopK 长度（看板按自己的 k 截取前几名）；trend_k / trend_threshold 同 /api/trending
+    TopKStream(Analyzer& analyzer, int k = 50, int trend_k = 5, int trend_threshold = 5, int interval_ms = 1000)
+        : analyzer_(analyzer), k_(k), trend_k_(trend_k), trend_threshold_(trend_threshold), interval_ms_(interval_ms) {
+    }
+
+    ~TopKStream() {
+        Stop();
+    }
+
+    // id 用来退订（比如 websocket 连接的地址），订阅后立刻收到一份完整快照
+    void Subscribe(const void* id, Sender sender) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!has_last_) Refresh(); // 之前没人订阅，基线过期了：先算一遍
+        sender(Snapshot());
+        subscribers_[id] = std::move(sender);
+    }
+
+    void Unsubscribe(const void* id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.erase(id);
+    }
+
+    std::size_t SubscriberCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscribers_.size();
+    }
+
+    void Start() {
+        thread_ = std::thread(&TopKStream::Loop, this);
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+};
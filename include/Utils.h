@@ -10,6 +10,7 @@
 #include <cassert>
 #include <cmath>
 #include <exception>
+#include "AsyncLogger.h"
 
 /*
     举例：输入："[0:00:08]"，输出：8000 (毫秒)
@@ -31,7 +32,7 @@ inline long long ParseTimestamp(const std::string& time_str){
         long long hours = std::stoll(sub_hour);
         curr_time += hours * 3600LL;
     } catch (const std::exception& e) {
-        std::cerr << "Conversion error (hour): " << e.what() << std::endl;
+        LOG(WARN) << "Conversion error (hour): " << e.what();
         throw;
     }
 
@@ -41,7 +42,7 @@ inline long long ParseTimestamp(const std::string& time_str){
     try {
         minutes = std::stoll(sub_min);
     } catch (const std::exception& e) {
-        std::cerr << "Conversion error (minutes): " << e.what() << std::endl;
+        LOG(WARN) << "Conversion error (minutes): " << e.what();
         throw;
     }
     assert(0LL <= minutes && minutes <= 60LL);
@@ -58,7 +59,7 @@ inline long long ParseTimestamp(const std::string& time_str){
         double total_seconds = static_cast<double>(curr_time) + seconds;
         return static_cast<long long>(total_seconds * 1000.0);
     } catch (const std::exception& e) {
-        std::cerr << "Conversion error (seconds): " << e.what() << std::endl;
+        LOG(WARN) << "Conversion error (seconds): " << e.what();
         throw;
     }
 }
@@ -81,6 +82,27 @@ inline std::string ExtractTimeTag(const std::string& input) {
     return "error";
 }
 
+/*
+    窗口长度：数字 + 单位(s/m/h/d)，如 "30s" "5m" "24h"，输出毫秒；格式不对返回 -1
+*/
+inline long long ParseWindowDuration(const std::string& spec) {
+    if (spec.size() < 2) return -1;
+    long long unit_ms = 0;
+    switch (spec.back()) {
+        case 's': unit_ms = 1000LL; break;
+        case 'm': unit_ms = 60 * 1000LL; break;
+        case 'h': unit_ms = 3600 * 1000LL; break;
+        case 'd': unit_ms = 24 * 3600 * 1000LL; break;
+        default: return -1;
+    }
+    long long value = 0;
+    for (std::size_t i = 0; i + 1 < spec.size(); ++i) {
+        if (spec[i] < '0' || spec[i] > '9' || value > 1000000) return -1;
+        value = value * 10 + (spec[i] - '0');
+    }
+    return value > 0 ? value * unit_ms : -1;
+}
+
 /*
     线性回归辅助结构
 */
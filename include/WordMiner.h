@@ -0,0 +1,400 @@
+/*
+    新词发现：弹幕里大量网络用语不在词典里，HMM 对它们的切分不稳定
+    （同一个词有时整体、有时拆成两三段），计数被打散，真正的热词上不了榜。
+
+    WordMiner 在后台线程里对最近一段时间的原始弹幕做统计：
+    - n-gram 词频（只统计连续汉字片段，长度 2 ~ max_word_len）
+    - 凝固度：min over 切分点 log( p(w) / (p(a) * p(b)) )，即最弱切分点上的 PMI
+    - 自由度：左右邻字的信息熵，取较小的一边（行首行尾视为各不相同的邻字）
+    三项都过阈值、且不在当前词典里的 n-gram 作为候选，按得分排序后写入在线词典（热更新）。
+
+    代价控制：
+    - worker 线程只 try_lock 一下把行拷进待处理队列，队列满了或锁被占用直接丢（相当于采样）
+    - 统计按时间分桶（默认 1 分钟一桶，保留 10 桶），整个窗口的 n-gram 总频次增量维护，
+      桶过期时减掉；每个桶的 n-gram 数有上限，超了就从低频开始裁剪
+    - 邻字熵只对频次过线的 n-gram 计算
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include "Analyzer.h"
+
+struct WordMinerOptions {
+    std::size_t max_word_len = 4;              // 最长候选词（字数）
+    long long bucket_ms = 60 * 1000;           // 统计桶的跨度
+    std::size_t bucket_count = 10;             // 保留的桶数，窗口 = bucket_ms * bucket_count
+    std::size_t max_ngrams_per_bucket = 200000;
+    std::size_t max_pending_lines = 20000;     // 待处理队列上限，超了直接丢
+    int interval_ms = 5000;                    // 后台线程的运行间隔
+    int min_count = 20;                        // 窗口内最少出现次数
+    double min_cohesion = 3.0;                 // 最弱切分点上的 PMI（自然对数）
+    double min_entropy = 1.5;                  // 左右邻字熵的下限
+    std::size_t max_promotions = 20;           // 每轮最多写入词典的词数
+    long long min_promote_interval_ms = 60 * 1000; // 两次写词典的最小间隔：每次都要整棵复制词典树、让分词缓存全部失效
+    bool auto_promote = true;                  // false 时只给出候选，不写词典
+    std::string tag = "nz";                    // 新词写入词典时的词性
+};
+
+struct NewWordCandidate {
+    std::string word;
+    int count;
+    double cohesion;
+    double left_entropy;
+    double right_entropy;
+    double score;
+};
+
+class WordMiner {
+private:
+    // 一个 n-gram 在某个桶内的统计
+    struct NgramStats {
+        int count = 0;
+        int left_boundary = 0;  // 出现在片段开头的次数
+        int right_boundary = 0; // 出现在片段结尾的次数
+        std::unordered_map<cppjieba::Rune, int> left;
+        std::unordered_map<cppjieba::Rune, int> right;
+    };
+
+    struct MinerBucket {
+        long long start_time;
+        std::unordered_map<std::string, NgramStats> ngrams;
+        std::unordered_map<cppjieba::Rune, int> chars;
+        long long total_chars = 0;
+        int prune_floor = 0; // 已被裁掉的最高频次，估算误差的上界
+    };
+
+    struct PendingLine {
+        long long timestamp;
+        std::string content;
+    };
+
+    Analyzer& analyzer_;
+    WordMinerOptions options_;
+
+    // worker -> 后台线程
+    std::mutex pending_mutex_;
+    std::vector<PendingLine> pending_;
+    std::atomic<unsigned long long> dropped_{0};
+
+    // 以下只在后台线程里读写
+    std::deque<MinerBucket> buckets_;
+    std::unordered_map<std::string, int> window_counts_;             // n-gram 窗口总频次
+    std::unordered_map<cppjieba::Rune, int> window_chars_;           // 单字窗口总频次
+    long long window_total_chars_ = 0;
+
+    // 查询接口读
+    mutable std::mutex result_mutex_;
+    std::vector<NewWordCandidate> candidates_;
+    std::vector<std::string> promoted_;
+    std::chrono::steady_clock::time_point last_promotion_{}; // 只在后台线程里读写
+
+    std::thread thread_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stop_ = false;
+
+    static bool IsHan(cppjieba::Rune r) {
+        return (r >= 0x4E00 && r <= 0x9FFF) || (r >= 0x3400 && r <= 0x4DBF);
+    }
+
+    static double Entropy(const std::unordered_map<cppjieba::Rune, int>& neighbors, int boundary) {
+        double total = boundary;
+        for (const auto& kv : neighbors) total += kv.second;
+        if (total <= 0) return 0.0;
+        double h = 0.0;
+        for (const auto& kv : neighbors) {
+            double p = kv.second / total;
+            h -= p * std::log(p);
+        }
+        // 行首/行尾当作互不相同的邻字，每次贡献 -(1/N)log(1/N)
+        if (boundary > 0) h += boundary / total * std::log(total);
+        return h;
+    }
+
+    MinerBucket* BucketFor(long long timestamp) {
+        long long start = timestamp / options_.bucket_ms * options_.bucket_ms;
+        if (buckets_.empty() || start > buckets_.back().start_time) {
+            buckets_.push_back(MinerBucket{start, {}, {}});
+            long long oldest = start - (long long)(options_.bucket_count - 1) * options_.bucket_ms;
+            while (buckets_.front().start_time < oldest) {
+                ExpireFront();
+            }
+            return &buckets_.back();
+        }
+        // 乱序到达的行：落到已有的桶里，太旧的丢掉
+        for (auto it = buckets_.rbegin(); it != buckets_.rend(); ++it) {
+            if (it->start_time == start) return &*it;
+            if (it->start_time < start) break;
+        }
+        return nullptr;
+    }
+
+    void ExpireFront() {
+        MinerBucket& b = buckets_.front();
+        for (const auto& kv : b.ngrams) {
+            Decrease(window_counts_, kv.first, kv.second.count);
+        }
+        for (const auto& kv : b.chars) {
+            Decrease(window_chars_, kv.first, kv.second);
+        }
+        window_total_chars_ -= b.total_chars;
+        buckets_.pop_front();
+    }
+
+    template <class Map, class Key>
+    static void Decrease(Map& m, const Key& key, int delta) {
+        auto it = m.find(key);
+        if (it == m.end()) return;
+        it->second -= delta;
+        if (it->second <= 0) m.erase(it);
+    }
+
+    // 桶内 n-gram 超过上限时，从低频开始裁，直到降到上限的 3/4
+    void Prune(MinerBucket& b) {
+        std::size_t target = options_.max_ngrams_per_bucket / 4 * 3;
+        while (b.ngrams.size() > target) {
+            b.prune_floor++;
+            for (auto it = b.ngrams.begin(); it != b.ngrams.end();) {
+                if (it->second.count <= b.prune_floor) {
+                    Decrease(window_counts_, it->first, it->second.count);
+                    it = b.ngrams.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    void AddLine(MinerBucket& b, const std::string& content, cppjieba::RuneStrArray& runes) {
+        runes.clear();
+        if (!cppjieba::DecodeUTF8RunesInString(content, runes)) return;
+
+        std::size_t i = 0;
+        while (i < runes.size()) {
+            if (!IsHan(runes[i].rune)) { i++; continue; }
+            std::size_t j = i;
+            while (j < runes.size() && IsHan(runes[j].rune)) j++;
+
+            // [i, j) 是一段连续汉字
+            for (std::size_t p = i; p < j; p++) {
+                b.chars[runes[p].rune]++;
+                window_chars_[runes[p].rune]++;
+            }
+            b.total_chars += j - i;
+            window_total_chars_ += j - i;
+
+            for (std::size_t p = i; p < j; p++) {
+                for (std::size_t n = 2; n <= options_.max_word_len && p + n <= j; n++) {
+                    uint32_t begin = runes[p].offset;
+                    uint32_t end = runes[p + n - 1].offset + runes[p + n - 1].len;
+                    std::string key = content.substr(begin, end - begin);
+                    NgramStats& s = b.ngrams[key];
+                    s.count++;
+                    if (p == i) s.left_boundary++;
+                    else s.left[runes[p - 1].rune]++;
+                    if (p + n == j) s.right_boundary++;
+                    else s.right[runes[p + n].rune]++;
+                    window_counts_[key]++;
+                }
+            }
+            i = j;
+        }
+        if (b.ngrams.size() > options_.max_ngrams_per_bucket) Prune(b);
+    }
+
+    int CountOf(const std::string& word, const cppjieba::RuneStrArray& runes, std::size_t begin, std::size_t end) const {
+        if (end - begin == 1) {
+            auto it = window_chars_.find(runes[begin].rune);
+            return it == window_chars_.end() ? 0 : it->second;
+        }
+        uint32_t b = runes[begin].offset;
+        uint32_t e = runes[end - 1].offset + runes[end - 1].len;
+        auto it = window_counts_.find(word.substr(b, e - b));
+        return it == window_counts_.end() ? 0 : it->second;
+    }
+
+    // 对窗口内频次过线的 n-gram 计算凝固度和自由度
+    std::vector<NewWordCandidate> Evaluate(const cppjieba::DictHandle& dict) const {
+        std::vector<NewWordCandidate> result;
+        if (window_total_chars_ == 0) return result;
+        const double total = (double)window_total_chars_;
+
+        cppjieba::RuneStrArray runes;
+        cppjieba::Unicode unicode;
+        for (const auto& kv : window_counts_) {
+            if (kv.second < options_.min_count) continue;
+            const std::string& word = kv.first;
+            runes.clear();
+            if (!cppjieba::DecodeUTF8RunesInString(word, runes)) continue;
+
+            // 已经在词典里的不用再提
+            unicode.clear();
+            for (const auto& r : runes) unicode.push_back(r.rune);
+            if (dict->trie->Find(unicode.begin(), unicode.end()) != nullptr) continue;
+
+            double cohesion = INFINITY;
+            for (std::size_t split = 1; split < runes.size(); split++) {
+                int a = CountOf(word, runes, 0, split);
+                int b = CountOf(word, runes, split, runes.size());
+                if (a == 0 || b == 0) { cohesion = -INFINITY; break; } // 子串被裁掉了，证据不足
+                cohesion = std::min(cohesion, std::log(kv.second * total / ((double)a * b)));
+            }
+            if (cohesion < options_.min_cohesion) continue;
+
+            std::unordered_map<cppjieba::Rune, int> left, right;
+            int left_boundary = 0, right_boundary = 0;
+            for (const auto& b : buckets_) {
+                auto it = b.ngrams.find(word);
+                if (it == b.ngrams.end()) continue;
+                for (const auto& l : it->second.left) left[l.first] += l.second;
+                for (const auto& r : it->second.right) right[r.first] += r.second;
+                left_boundary += it->second.left_boundary;
+                right_boundary += it->second.right_boundary;
+            }
+            double hl = Entropy(left, left_boundary);
+            double hr = Entropy(right, right_boundary);
+            if (std::min(hl, hr) < options_.min_entropy) continue;
+
+            NewWordCandidate c;
+            c.word = word;
+            c.count = kv.second;
+            c.cohesion = cohesion;
+            c.left_entropy = hl;
+            c.right_entropy = hr;
+            c.score = std::log((double)kv.second) * std::min(hl, hr) * cohesion;
+            result.push_back(std::move(c));
+        }
+
+        // 被更长候选几乎完全覆盖的子串（如 "蓝莓派" 里的 "莓派"）去掉
+        std::sort(result.begin(), result.end(), [](const NewWordCandidate& a, const NewWordCandidate& b) {
+            return a.word.size() > b.word.size();
+        });
+        std::vector<NewWordCandidate> kept;
+        for (auto& c : result) {
+            bool covered = false;
+            for (const auto& longer : kept) {
+                if (longer.word.find(c.word) != std::string::npos && longer.count * 10 >= c.count * 9) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (!covered) kept.push_back(std::move(c));
+        }
+        std::sort(kept.begin(), kept.end(), [](const NewWordCandidate& a, const NewWordCandidate& b) {
+            return a.score > b.score;
+        });
+        return kept;
+    }
+
+    void RunOnce() {
+        std::vector<PendingLine> lines;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            lines.swap(pending_);
+        }
+        cppjieba::RuneStrArray runes;
+        for (const auto& line : lines) {
+            MinerBucket* b = BucketFor(line.timestamp);
+            if (b != nullptr) AddLine(*b, line.content, runes);
+        }
+
+        cppjieba::DictHandle dict = analyzer_.AcquireDict();
+        std::vector<NewWordCandidate> candidates = Evaluate(dict);
+
+        // 候选在窗口内一直有效，没到间隔就留到下一轮，攒成一批再写
+        std::vector<std::string> promoted;
+        auto now = std::chrono::steady_clock::now();
+        bool promote_due = last_promotion_ == std::chrono::steady_clock::time_point{} ||
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - last_promotion_).count() >= options_.min_promote_interval_ms;
+        if (options_.auto_promote && promote_due && !candidates.empty()) {
+            std::vector<std::pair<std::string, std::string>> inserts;
+            for (std::size_t i = 0; i < candidates.size() && i < options_.max_promotions; i++) {
+                inserts.emplace_back(candidates[i].word, options_.tag);
+                promoted.push_back(candidates[i].word);
+            }
+            analyzer_.UpdateDictionary(inserts, {});
+            last_promotion_ = now;
+            LOG(INFO) << "[WordMiner] Promoted " << inserts.size() << " new words into dictionary.";
+        }
+
+        std::lock_guard<std::mutex> lock(result_mutex_);
+        candidates_ = std::move(candidates);
+        promoted_.insert(promoted_.end(), promoted.begin(), promoted.end());
+        const std::size_t MAX_PROMOTED_HISTORY = 1000;
+        if (promoted_.size() > MAX_PROMOTED_HISTORY) {
+            promoted_.erase(promoted_.begin(), promoted_.end() - MAX_PROMOTED_HISTORY);
+        }
+    }
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (!stop_) {
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(options_.interval_ms), [this] { return stop_; });
+            if (stop_) break;
+            lock.unlock();
+            RunOnce();
+            lock.lock();
+        }
+    }
+
+public:
+    WordMiner(Analyzer& analyzer, WordMinerOptions options = WordMinerOptions())
+        : analyzer_(analyzer), options_(options) {
+    }
+
+    ~WordMiner() {
+        Stop();
+    }
+
+    void Start() {
+        thread_ = std::thread(&WordMiner::Loop, this);
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    // worker 线程调用：content 是去掉时间标签后的弹幕正文
+    // 不等锁、不做任何计算，拿不到锁或队列已满就丢弃这一行
+    void Feed(long long timestamp, const std::string& content) {
+        std::unique_lock<std::mutex> lock(pending_mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || pending_.size() >= options_.max_pending_lines) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pending_.push_back(PendingLine{timestamp, content});
+    }
+
+    // 最近一轮的候选词（按得分降序）
+    std::vector<NewWordCandidate> GetCandidates(std::size_t k) const {
+        std::lock_guard<std::mutex> lock(result_mutex_);
+        return std::vector<NewWordCandidate>(candidates_.begin(),
+            candidates_.begin() + std::min(k, candidates_.size()));
+    }
+
+    // 已写入词典的新词（最近的在后）
+    std::vector<std::string> GetPromoted() const {
+        std::lock_guard<std::mutex> lock(result_mutex_);
+        return promoted_;
+    }
+
+    unsigned long long GetDroppedLines() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,667 @@
+/*
+    统计数据的持久化：预写日志 (WAL) + 定期快照，重启后不用把原始弹幕重新分一遍词
+
+    Analyzer 的状态全在内存里，原来重启就全丢了，要恢复只能把原始数据流重新喂一遍 jieba。这里记的是
+    分好词、聚合好的结果，也就是每次 IngestBatch 提交的 (秒级时间桶, 词, 词频) 增量：
+    - IngestBatch 在写锁内把这一批编码追加到内存里的待写缓冲，不碰磁盘；WalCommitter 的后台线程每隔
+      commit_interval_ms 把所有待写的记录一次写进文件、一次 fdatasync（group commit），
+      所以崩溃最多丢最后一个提交间隔的数据
+    - 日志分段 wal-<序号>.log。每段有自己的词表：词第一次出现时把字符串（和词性）写进记录，之后只写 id，
+      每段可以单独解析、单独删除
+    - 每条记录：[u32 长度][u32 crc32][内容]，内容 = 时间桶、本批新词、(词 id, 词频) 列表，
+      数字用 BinaryWriter.h 的 varint 编码；crc 对不上或不完整的记录（写到一半崩溃）及其之后的部分丢弃
+    - 每隔 snapshot_interval_ms 或日志超过 snapshot_wal_bytes，在 Analyzer 读锁内切到新的日志段，
+      出锁后把所有时间桶写成快照 snapshot-<新段序号>.bin（先写临时文件、fsync 后再 rename），之后删掉更早的日志段和快照。
+      每个桶的编码缓存在这里，词 id 在各次快照间不变，持锁期间只重新编码上次快照后被写过的桶
+    - 恢复：加载最新的完整快照，再按顺序重放序号不小于它的日志段，都是直接调用 IngestBatch，
+      全局计数、窗口、排名都按原来的逻辑重建
+    - 打开了冷存储（见 ColdArchive.h）时，快照前先把够老的桶写成段文件，快照只存热数据和段文件名列表；
+      恢复时只打开快照列出的段，之后写出、但没赶上快照的段删掉（它们的数据还在快照和日志里）
+    共现图是窗口内的短期数据，不记日志，重启后 10 分钟内自然重建
+*/
+#pragma once
+#include "Analyzer.h"
+#include "BinaryWriter.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct WriteAheadLogOptions {
+    long long snapshot_interval_ms = 5 * 60 * 1000;
+    std::size_t snapshot_wal_bytes = 64u << 20; // 当前日志段超过这么大也做一次快照
+};
+
+class WriteAheadLog {
+private:
+    static constexpr char kWalMagic[8] = {'H', 'W', 'W', 'A', 'L', '0', '0', '1'};
+    static constexpr char kSnapshotMagic[8] = {'H', 'W', 'S', 'N', 'A', 'P', '0', '2'};
+    static constexpr char kSnapshotMagicV1[8] = {'H', 'W', 'S', 'N', 'A', 'P', '0', '1'}; // 没有冷存储段列表
+
+    std::string dir_;
+    WriteAheadLogOptions options_;
+
+    // 以下由 mutex_ 保护：Append 在 Analyzer 写锁内调用，只和提交线程交换缓冲时竞争
+    std::mutex mutex_;
+    std::string pending_;   // 已经计入 Analyzer、还没写盘的记录
+    std::unordered_map<std::string, uint32_t> word_ids_; // 当前日志段的词表
+    std::string record_;    // 编码一条记录用的缓冲，复用
+    uint64_t segment_ = 0;  // 当前日志段序号
+    std::unordered_set<long long> dirty_; // 上次快照之后写过的时间桶
+    int fd_ = -1;
+    std::size_t segment_bytes_ = 0;
+
+    // Commit / Snapshot 只在提交线程里调用，这把锁保证它们不会交错（fd_ 只在持有它时替换）
+    std::mutex commit_mutex_;
+    std::size_t segment_synced_ = 0; // 当前日志段已经落盘的字节数
+    bool segment_torn_ = false;      // 写失败后没能截回 segment_synced_，下次写之前要先截断
+    // 快照切段后没能写进旧日志段的记录，之后的 Commit / Snapshot 先重试它
+    int retired_fd_ = -1;
+    uint64_t retired_segment_ = 0;
+    std::string retired_pending_;
+    std::size_t retired_synced_ = 0;
+    bool retired_torn_ = false;
+    // 快照的编码缓存：词 id 在各次快照间不变，每个桶的编码保留到它被再次写入或移出内存。
+    // 词表只增不减，桶移出内存后它们独有的词（一次性的未登录词）还留着；词数涨到上次全量编码时的
+    // 两倍，就清空词表、按内存里的桶全量重新编码，词表和快照大小跟着热数据走，而不是跟着运行时长涨
+    std::unordered_map<std::string, uint32_t> snapshot_ids_;
+    std::string snapshot_words_; // {[词性][词]}...，按 id 顺序
+    std::unordered_map<long long, std::string> encoded_buckets_; // 时间桶 -> [时间桶][个数]{[词 id][词频]}...
+    bool encoded_all_ = false;   // 启动后的第一次快照要编码所有的桶
+    std::size_t compacted_words_ = 0; // 上次全量编码后的词数
+    std::chrono::steady_clock::time_point last_snapshot_ = std::chrono::steady_clock::now();
+    uint64_t synced_bytes_ = 0;
+    uint64_t snapshot_segment_ = 0; // 最近一次快照对应的段序号
+
+    std::string SegmentPath(uint64_t seq) const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "wal-%020llu.log", (unsigned long long)seq);
+        return dir_ + "/" + name;
+    }
+
+    std::string SnapshotPath(uint64_t seq) const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "snapshot-%020llu.bin", (unsigned long long)seq);
+        return dir_ + "/" + name;
+    }
+
+    // 目录下某种文件的序号，升序
+    std::vector<uint64_t> ListFiles(const char* prefix, const char* suffix) const {
+        std::vector<uint64_t> seqs;
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(dir_, ec);
+             !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (!name.starts_with(prefix) || !name.ends_with(suffix)) continue;
+            std::string digits = name.substr(std::strlen(prefix), name.size() - std::strlen(prefix) - std::strlen(suffix));
+            if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) continue;
+            seqs.push_back(std::stoull(digits));
+        }
+        std::sort(seqs.begin(), seqs.end());
+        return seqs;
+    }
+
+    static void PutFixed32(std::string& out, uint32_t v) {
+        char buf[4];
+        for (int i = 0; i < 4; ++i) buf[i] = (char)((v >> (8 * i)) & 0xFF);
+        out.append(buf, 4);
+    }
+
+    static uint32_t GetFixed32(const char* p) {
+        const unsigned char* u = (const unsigned char*)p;
+        return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+    }
+
+    static uint32_t Crc(std::string_view data) {
+        return (uint32_t)crc32(0L, (const Bytef*)data.data(), (uInt)data.size());
+    }
+
+    static bool WriteAll(int fd, const std::string& data) {
+        const char* p = data.data();
+        std::size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            left -= n;
+        }
+        return true;
+    }
+
+    /*
+        把 batch 追加到日志段 fd 并 fdatasync，synced 是这个段已经落盘的字节数。
+        写失败时把文件截回 synced，调用方留着 batch 下次重试：恢复时读到半条记录就停了，
+        不能在它后面接着写；截不回去就记下 torn，之后每次写之前先重试截断
+    */
+    static bool AppendDurable(int fd, const std::string& batch, std::size_t& synced, bool& torn) {
+        if (torn) {
+            if (::ftruncate(fd, (off_t)synced) != 0) return false;
+            torn = false;
+        }
+        if (WriteAll(fd, batch) && ::fdatasync(fd) == 0) {
+            synced += batch.size();
+            return true;
+        }
+        int err = errno;
+        torn = ::ftruncate(fd, (off_t)synced) != 0;
+        errno = err;
+        return false;
+    }
+
+    void SyncDir() const {
+        int dfd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dfd < 0) return;
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+
+    // 新建日志段 seq（调用方持有 mutex_）；旧的 fd 由调用方处理
+    bool OpenSegment(uint64_t seq) {
+        int fd = ::open(SegmentPath(seq).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            LOG(ERROR) << "[WAL] Cannot create " << SegmentPath(seq) << ": " << std::strerror(errno);
+            return false;
+        }
+        fd_ = fd;
+        segment_ = seq;
+        segment_synced_ = 0;
+        segment_torn_ = false;
+        word_ids_.clear();
+        pending_.assign(kWalMagic, sizeof(kWalMagic));
+        segment_bytes_ = pending_.size();
+        return true;
+    }
+
+    // 快照：[magic][词数]{[词性][词]}...[桶数]{[时间桶][个数]{[词 id][词频]}...}...[段数]{[段文件名]}...[u32 crc]
+    // 这里编码一个桶，新词追加进 snapshot_words_（调用方持有 commit_mutex_）
+    void EncodeBucket(const TimeBucket& bucket, const std::unordered_map<std::string, uint8_t>& tags, std::string& out) {
+        BinaryWriter b(out);
+        b.Int(bucket.bucket_start_time).UInt(bucket.word_counts.size());
+        for (const auto& kv : bucket.word_counts) {
+            auto r = snapshot_ids_.emplace(kv.first, (uint32_t)snapshot_ids_.size());
+            if (r.second) {
+                auto it = tags.find(kv.first);
+                BinaryWriter(snapshot_words_).UInt(it == tags.end() ? 0 : it->second).String(kv.first);
+            }
+            b.UInt(r.first->second).Int(kv.second);
+        }
+    }
+
+    // 上次快照时没写进旧日志段的记录，补写成功后关掉旧段（调用方持有 commit_mutex_）
+    bool FlushRetired() {
+        if (retired_fd_ < 0) return true;
+        if (!AppendDurable(retired_fd_, retired_pending_, retired_synced_, retired_torn_)) {
+            LOG(ERROR) << "[WAL] Write to " << SegmentPath(retired_segment_) << " failed, will retry: " << std::strerror(errno);
+            return false;
+        }
+        synced_bytes_ += retired_pending_.size();
+        ::close(retired_fd_);
+        retired_fd_ = -1;
+        retired_pending_.clear();
+        return true;
+    }
+
+    static bool ReadFile(const std::string& path, std::string& data) {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.is_open()) return false;
+        std::ostringstream oss;
+        oss << ifs.rdbuf();
+        data = oss.str();
+        return true;
+    }
+
+    /*
+        把快照里的时间桶按顺序交给 Analyzer，cold_segments 返回它引用的冷存储段；
+        文件不完整或校验失败时返回 false（先校验整个文件再解析，不会只加载一半）
+    */
+    static bool LoadSnapshot(const std::string& path, Analyzer& analyzer, std::size_t& buckets_loaded,
+                             std::vector<std::string>& cold_segments) {
+        std::string data;
+        if (!ReadFile(path, data) || data.size() < sizeof(kSnapshotMagic) + 4) return false;
+        bool v1 = std::memcmp(data.data(), kSnapshotMagicV1, sizeof(kSnapshotMagicV1)) == 0;
+        if (!v1 && std::memcmp(data.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return false;
+        std::string_view content(data.data(), data.size() - 4);
+        if (Crc(content) != GetFixed32(data.data() + data.size() - 4)) return false;
+
+        try {
+            BinaryReader r(content.substr(sizeof(kSnapshotMagic)));
+            std::vector<std::string> words(r.UInt());
+            std::vector<uint8_t> word_tags(words.size());
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                word_tags[i] = (uint8_t)r.UInt();
+                words[i] = r.String();
+            }
+            std::unordered_map<std::string, int> counts;
+            std::unordered_map<std::string, uint8_t> tags;
+            uint64_t n = r.UInt();
+            for (uint64_t i = 0; i < n; ++i) {
+                long long bucket_ts = r.Int();
+                uint64_t m = r.UInt();
+                counts.clear();
+                tags.clear();
+                for (uint64_t j = 0; j < m; ++j) {
+                    uint64_t id = r.UInt();
+                    int count = (int)r.Int();
+                    if (id >= words.size()) return false;
+                    counts[words[id]] += count;
+                    if (word_tags[id] != 0) tags.emplace(words[id], word_tags[id]);
+                }
+                analyzer.IngestBatch(counts, bucket_ts, &tags);
+            }
+            buckets_loaded = n;
+            cold_segments.clear();
+            if (!v1) {
+                uint64_t segments = r.UInt();
+                for (uint64_t i = 0; i < segments; ++i) cold_segments.emplace_back(r.String());
+            }
+        } catch (const std::exception&) {
+            return false; // crc 对得上但内容不对，只可能是版本不兼容
+        }
+        return true;
+    }
+
+    // 按顺序重放一个日志段，遇到不完整或校验失败的记录就停（之后的内容是崩溃时没写完的）
+    static std::size_t ReplaySegment(const std::string& path, Analyzer& analyzer) {
+        std::string data;
+        if (!ReadFile(path, data) || data.size() < sizeof(kWalMagic) ||
+            std::memcmp(data.data(), kWalMagic, sizeof(kWalMagic)) != 0) {
+            return 0;
+        }
+        std::vector<std::string> words;
+        std::vector<uint8_t> word_tags;
+        std::unordered_map<std::string, int> counts;
+        std::unordered_map<std::string, uint8_t> tags;
+        std::size_t records = 0;
+        std::size_t pos = sizeof(kWalMagic);
+        while (data.size() - pos >= 8) {
+            uint32_t len = GetFixed32(data.data() + pos);
+            uint32_t crc = GetFixed32(data.data() + pos + 4);
+            if (data.size() - pos - 8 < len) break;
+            std::string_view payload(data.data() + pos + 8, len);
+            if (Crc(payload) != crc) break;
+            pos += 8 + len;
+
+            try {
+                BinaryReader r(payload);
+                long long bucket_ts = r.Int();
+                uint64_t new_words = r.UInt();
+                for (uint64_t i = 0; i < new_words; ++i) {
+                    word_tags.push_back((uint8_t)r.UInt());
+                    words.emplace_back(r.String());
+                }
+                uint64_t n = r.UInt();
+                counts.clear();
+                tags.clear();
+                for (uint64_t i = 0; i < n; ++i) {
+                    uint64_t id = r.UInt();
+                    int count = (int)r.Int();
+                    if (id >= words.size()) throw std::runtime_error("bad word id");
+                    counts[words[id]] += count;
+                    if (word_tags[id] != 0) tags.emplace(words[id], word_tags[id]);
+                }
+                analyzer.IngestBatch(counts, bucket_ts, &tags);
+                ++records;
+            } catch (const std::exception&) {
+                break;
+            }
+        }
+        if (pos != data.size()) {
+            LOG(WARN) << "[WAL] Ignored " << (data.size() - pos) << " trailing bytes in " << path;
+        }
+        return records;
+    }
+
+public:
+    explicit WriteAheadLog(const std::string& dir, WriteAheadLogOptions options = WriteAheadLogOptions())
+        : dir_(dir), options_(options) {
+    }
+
+    ~WriteAheadLog() {
+        Commit();
+        if (fd_ >= 0) ::close(fd_);
+        if (retired_fd_ >= 0) ::close(retired_fd_);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /*
+        启动时调用一次，必须在 Analyzer 开始处理数据、AttachWal 之前：
+        加载最新的完整快照，重放之后的日志段，然后新开一个日志段接着写
+    */
+    bool Recover(Analyzer& analyzer) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        if (ec) {
+            LOG(ERROR) << "[WAL] Cannot create " << dir_ << ": " << ec.message();
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<uint64_t> snapshots = ListFiles("snapshot-", ".bin");
+        std::vector<uint64_t> segments = ListFiles("wal-", ".log");
+        uint64_t from = 0;
+        std::size_t buckets = 0;
+        std::vector<std::string> cold_segments;
+        // 最新的快照读不出来就试更早的（正常情况下旧快照在新快照写好后就删了，这里只是尽力而为）
+        for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+            if (LoadSnapshot(SnapshotPath(*it), analyzer, buckets, cold_segments)) {
+                from = *it;
+                break;
+            }
+            LOG(WARN) << "[WAL] Skipped unreadable snapshot " << SnapshotPath(*it);
+        }
+        // 列表为空也要调用：删掉快照之后才写出的段，否则它们的数据和日志重放的会重复
+        if (!analyzer.RestoreColdArchive(cold_segments)) {
+            LOG(ERROR) << "[WAL] Missing cold segments in " << dir_ << ", historical range queries will be incomplete";
+        }
+        std::size_t records = 0;
+        for (uint64_t seq : segments) {
+            if (seq < from) continue;
+            std::error_code size_ec;
+            if (std::filesystem::file_size(SegmentPath(seq), size_ec) <= sizeof(kWalMagic) && !size_ec) {
+                std::remove(SegmentPath(seq).c_str()); // 上次启动后没写过数据的空段
+                continue;
+            }
+            records += ReplaySegment(SegmentPath(seq), analyzer);
+        }
+
+        uint64_t next = std::max<uint64_t>(from, segments.empty() ? 0 : segments.back()) + 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!OpenSegment(next)) return false;
+        }
+        SyncDir();
+        snapshot_segment_ = from;
+        last_snapshot_ = std::chrono::steady_clock::now();
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(last_snapshot_ - start).count();
+        LOG(INFO) << "[WAL] Recovered " << dir_ << ": snapshot " << from << " (" << buckets << " buckets) + "
+                  << records << " log records in " << ms << " ms";
+        return true;
+    }
+
+    // 在 Analyzer 写锁内调用：把这一批编码进待写缓冲，词表里没有的词连同字符串一起写
+    void Append(long long bucket_ts, const std::unordered_map<std::string, int>& counts,
+                const std::unordered_map<std::string, uint8_t>* tags) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ < 0) return;
+        record_.clear();
+        BinaryWriter w(record_);
+        w.Int(bucket_ts);
+        std::size_t new_words = 0;
+        for (const auto& kv : counts) {
+            if (word_ids_.count(kv.first) == 0) ++new_words;
+        }
+        w.UInt(new_words);
+        for (const auto& kv : counts) {
+            auto r = word_ids_.emplace(kv.first, (uint32_t)word_ids_.size());
+            if (!r.second) continue;
+            uint8_t tag = 0;
+            if (tags != nullptr) {
+                auto it = tags->find(kv.first);
+                if (it != tags->end()) tag = it->second;
+            }
+            w.UInt(tag).String(kv.first);
+        }
+        w.UInt(counts.size());
+        for (const auto& kv : counts) {
+            w.UInt(word_ids_[kv.first]).Int(kv.second);
+        }
+
+        PutFixed32(pending_, (uint32_t)record_.size());
+        PutFixed32(pending_, Crc(record_));
+        pending_ += record_;
+        segment_bytes_ += 8 + record_.size();
+        dirty_.insert(bucket_ts);
+    }
+
+    // 把待写的记录一次写盘并 fdatasync（group commit），由提交线程定期调用；失败时这一批放回待写缓冲，下次重试
+    void Commit() {
+        std::lock_guard<std::mutex> commit_lock(commit_mutex_);
+        FlushRetired();
+        std::string batch;
+        int fd;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.empty() || fd_ < 0) return;
+            batch.swap(pending_);
+            fd = fd_;
+        }
+        if (!AppendDurable(fd, batch, segment_synced_, segment_torn_)) {
+            LOG(ERROR) << "[WAL] Write to " << SegmentPath(segment_) << " failed, will retry: " << std::strerror(errno);
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.insert(0, batch);
+            return;
+        }
+        synced_bytes_ += batch.size();
+    }
+
+    // 当前日志段里有没有记录（没有的话快照和上一个一样，不用做）
+    bool HasNewRecords() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return fd_ >= 0 && segment_bytes_ > sizeof(kWalMagic);
+    }
+
+    bool SnapshotDue() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ < 0 || segment_bytes_ <= sizeof(kWalMagic)) return false;
+        auto elapsed = std::chrono::steady_clock::now() - last_snapshot_;
+        return segment_bytes_ >= options_.snapshot_wal_bytes ||
+               std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= options_.snapshot_interval_ms;
+    }
+
+    /*
+        快照：先把够老的桶写进冷存储（写段文件很慢，不持 commit_mutex_，免得挡住 Commit 和读统计的接口；
+        只有提交线程会调，不会和另一次 ArchiveColdBuckets 并发），再在 Analyzer 读锁内（没有并发的 IngestBatch）切到新日志段，
+        同时重新编码上次快照后写过的桶，记下所有桶的顺序，所以快照正好包含旧段为止的所有记录；
+        出锁后写完旧段、拼出快照文件写盘，再删掉用不到的旧文件。
+        旧段写不进去就不做这次快照，那些记录留着下次重试（快照要等它们落盘之后才能做）
+    */
+    bool Snapshot(Analyzer& analyzer) {
+        analyzer.ArchiveColdBuckets();
+        std::lock_guard<std::mutex> commit_lock(commit_mutex_);
+        if (!FlushRetired()) return false;
+        std::string old_pending;
+        int old_fd = -1;
+        std::size_t old_synced = 0;
+        bool old_torn = false;
+        uint64_t seq = 0;
+        bool opened = false;
+        std::vector<long long> order;  // 内存里所有桶的时间，按顺序
+        std::string sealing;           // 正在写冷存储的桶，很少有，每次都重新编码
+        std::size_t sealing_count = 0;
+        std::vector<std::string> cold_segments;
+        analyzer.VisitState([&](const StateView& state) {
+            std::unordered_set<long long> dirty;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (fd_ < 0) return;
+                old_fd = fd_;
+                old_synced = segment_synced_;
+                old_torn = segment_torn_;
+                old_pending.swap(pending_);
+                seq = segment_ + 1;
+                opened = OpenSegment(seq);
+                if (!opened) {
+                    pending_.swap(old_pending); // 开不了新段就接着写旧段，这次不做快照
+                    return;
+                }
+                dirty.swap(dirty_);
+            }
+            const auto& buckets = state.buckets;
+            const std::size_t MIN_COMPACT_WORDS = 4096;
+            if (!encoded_all_ || snapshot_ids_.size() > 2 * std::max(compacted_words_, MIN_COMPACT_WORDS)) {
+                snapshot_ids_.clear();
+                snapshot_words_.clear();
+                encoded_buckets_.clear();
+                for (const auto& bucket : buckets) {
+                    EncodeBucket(bucket, state.tags, encoded_buckets_[bucket.bucket_start_time]);
+                }
+                compacted_words_ = snapshot_ids_.size();
+                encoded_all_ = true;
+            } else {
+                for (long long ts : dirty) {
+                    auto it = std::lower_bound(buckets.begin(), buckets.end(), ts,
+                        [](const TimeBucket& bucket, long long val) { return bucket.bucket_start_time < val; });
+                    if (it == buckets.end() || it->bucket_start_time != ts) continue; // 已经移出内存
+                    std::string& out = encoded_buckets_[ts];
+                    out.clear();
+                    EncodeBucket(*it, state.tags, out);
+                }
+            }
+            order.reserve(buckets.size());
+            for (const auto& bucket : buckets) order.push_back(bucket.bucket_start_time);
+            for (const auto& bucket : state.sealing) EncodeBucket(bucket, state.tags, sealing);
+            sealing_count = state.sealing.size();
+            cold_segments = state.cold_segments;
+        });
+        if (!opened) return false;
+
+        if (!AppendDurable(old_fd, old_pending, old_synced, old_torn)) {
+            LOG(ERROR) << "[WAL] Write to " << SegmentPath(seq - 1) << " failed, snapshot postponed: " << std::strerror(errno);
+            retired_fd_ = old_fd;
+            retired_segment_ = seq - 1;
+            retired_pending_.swap(old_pending);
+            retired_synced_ = old_synced;
+            retired_torn_ = old_torn;
+            return false;
+        }
+        ::close(old_fd);
+        synced_bytes_ += old_pending.size();
+
+        // 移出内存（写进冷存储）的桶不再缓存
+        if (encoded_buckets_.size() > order.size()) {
+            std::unordered_set<long long> live(order.begin(), order.end());
+            for (auto it = encoded_buckets_.begin(); it != encoded_buckets_.end();) {
+                it = live.count(it->first) ? std::next(it) : encoded_buckets_.erase(it);
+            }
+        }
+        std::string data(kSnapshotMagic, sizeof(kSnapshotMagic));
+        BinaryWriter w(data);
+        w.UInt(snapshot_ids_.size());
+        data += snapshot_words_;
+        w.UInt(sealing_count + order.size());
+        data += sealing;
+        for (long long ts : order) data += encoded_buckets_[ts];
+        w.UInt(cold_segments.size());
+        for (const auto& name : cold_segments) w.String(name);
+        PutFixed32(data, Crc(data));
+
+        std::string path = SnapshotPath(seq);
+        std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = fd >= 0 && WriteAll(fd, data) && ::fsync(fd) == 0;
+        if (fd >= 0) ::close(fd);
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            LOG(ERROR) << "[WAL] Snapshot " << path << " failed: " << std::strerror(errno);
+            std::remove(tmp.c_str());
+            return false; // 旧日志段都还在，恢复时从上一个快照重放
+        }
+        SyncDir();
+
+        for (uint64_t old : ListFiles("wal-", ".log")) {
+            if (old < seq) std::remove(SegmentPath(old).c_str());
+        }
+        for (uint64_t old : ListFiles("snapshot-", ".bin")) {
+            if (old < seq) std::remove(SnapshotPath(old).c_str());
+        }
+        snapshot_segment_ = seq;
+        last_snapshot_ = std::chrono::steady_clock::now();
+        LOG(INFO) << "[WAL] Snapshot " << path << " (" << data.size() << " bytes)";
+        return true;
+    }
+
+    uint64_t GetSyncedBytes() {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        return synced_bytes_;
+    }
+
+    uint64_t GetSnapshotSegment() {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        return snapshot_segment_;
+    }
+};
+
+/*
+    所有 WriteAheadLog（全局和每个频道各一个）共用一个提交线程：每隔 commit_interval_ms 依次提交，
+    到期的顺便做快照；Stop 时最后提交一次并各做一次快照，下次启动只需加载快照
+*/
+class WalCommitter {
+private:
+    int commit_interval_ms_;
+    std::mutex mutex_;
+    std::vector<std::pair<WriteAheadLog*, Analyzer*>> logs_;
+    std::thread thread_;
+    std::condition_variable wake_cv_;
+    bool stop_ = false;
+
+    std::vector<std::pair<WriteAheadLog*, Analyzer*>> Logs() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return logs_;
+    }
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(commit_interval_ms_), [this] { return stop_; });
+            if (stop_) break;
+            lock.unlock();
+            for (auto& log : Logs()) {
+                log.first->Commit();
+                if (log.first->SnapshotDue()) log.first->Snapshot(*log.second);
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    explicit WalCommitter(int commit_interval_ms = 100) : commit_interval_ms_(commit_interval_ms) {
+    }
+
+    ~WalCommitter() {
+        Stop();
+    }
+
+    // wal 和 analyzer 要活得比提交线程久（Stop 之后才能销毁）
+    void Add(WriteAheadLog* wal, Analyzer* analyzer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        logs_.emplace_back(wal, analyzer);
+    }
+
+    void Start() {
+        thread_ = std::thread(&WalCommitter::Loop, this);
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) return;
+            stop_ = true;
+        }
+        wake_cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+        for (auto& log : Logs()) {
+            log.first->Commit();
+            if (log.first->HasNewRecords()) log.first->Snapshot(*log.second);
+        }
+    }
+};
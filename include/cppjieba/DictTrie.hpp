@@ -9,6 +9,7 @@
 #include <deque>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include "limonp/StringUtil.hpp"
 #include "limonp/Logging.hpp"
@@ -21,6 +22,10 @@ const double MIN_DOUBLE = -3.14e+100;
 const double MAX_DOUBLE = 3.14e+100;
 const size_t DICT_COLUMN_NUM = 3;
 const char* const UNKNOWN_TAG = "";
+// tags PosTagger gives to words without a dict tag
+const char* const POS_M = "m";
+const char* const POS_ENG = "eng";
+const char* const POS_X = "x";
 
 class DictTrie {
  public:
@@ -31,20 +36,74 @@ class DictTrie {
   }; // enum UserWordWeightOption
 
   DictTrie(const std::string& dict_path, const std::string& user_dict_paths = "", UserWordWeightOption user_word_weight_opt = WordWeightMedian) {
+    InternTag(UNKNOWN_TAG); // tag id 0
+    pos_m_id_ = InternTag(POS_M);
+    pos_eng_id_ = InternTag(POS_ENG);
+    pos_x_id_ = InternTag(POS_X);
     Init(dict_path, user_dict_paths, user_word_weight_opt);
   }
 
+  // copy-on-write update for a dictionary that other threads are cutting
+  // with: builds an independent DictTrie = base - deletes + inserts and never
+  // writes to base. inserts are (word, tag) pairs weighted like user words.
+  DictTrie(const DictTrie& base,
+        const std::vector<std::pair<std::string, std::string> >& inserts,
+        const std::vector<std::string>& deletes)
+    : tags_(base.tags_),
+      tag_ids_(base.tag_ids_),
+      pos_m_id_(base.pos_m_id_),
+      pos_eng_id_(base.pos_eng_id_),
+      pos_x_id_(base.pos_x_id_),
+      trie_(NULL),
+      freq_sum_(base.freq_sum_),
+      min_weight_(base.min_weight_),
+      max_weight_(base.max_weight_),
+      median_weight_(base.median_weight_),
+      user_word_default_weight_(base.user_word_default_weight_),
+      user_dict_single_chinese_word_(base.user_dict_single_chinese_word_),
+      stop_runes_(base.stop_runes_),
+      stop_words_(base.stop_words_) {
+    std::unordered_set<std::string> deleted;
+    Unicode runes;
+    for (size_t i = 0; i < deletes.size(); i++) {
+      if (DecodeUTF8RunesInString(deletes[i], runes)) {
+        deleted.insert(RunesKey(runes.begin(), runes.size()));
+      }
+    }
+    // the word pool is rebuilt so deleted words do not leave holes in it
+    static_node_infos_.reserve(base.static_node_infos_.size() + base.active_node_infos_.size() + inserts.size());
+    word_pool_.reserve(base.word_pool_.size());
+    for (size_t i = 0; i < base.static_node_infos_.size(); i++) {
+      CopyUnit(base, base.static_node_infos_[i], deleted);
+    }
+    for (size_t i = 0; i < base.active_node_infos_.size(); i++) {
+      CopyUnit(base, base.active_node_infos_[i], deleted);
+    }
+    DictUnit node_info;
+    for (size_t i = 0; i < inserts.size(); i++) {
+      if (MakeNodeInfo(node_info, inserts[i].first, user_word_default_weight_, inserts[i].second)) {
+        static_node_infos_.push_back(node_info);
+      }
+    }
+    XCHECK(!static_node_infos_.empty());
+    Shrink(static_node_infos_);
+    CreateTrie(static_node_infos_);
+  }
+
   ~DictTrie() {
     delete trie_;
   }
 
+  // the in-place mutators below may grow word_pool_, which moves the runes of
+  // every unit. only call them on a DictTrie no other thread is reading yet
+  // (Jieba applies them to a fresh copy before publishing it).
   bool InsertUserWord(const std::string& word, const std::string& tag = UNKNOWN_TAG) {
     DictUnit node_info;
     if (!MakeNodeInfo(node_info, word, user_word_default_weight_, tag)) {
       return false;
     }
     active_node_infos_.push_back(node_info);
-    trie_->InsertNode(node_info.word, &active_node_infos_.back());
+    trie_->InsertNode(WordBegin(node_info), WordEnd(node_info), &active_node_infos_.back());
     return true;
   }
 
@@ -55,16 +114,22 @@ class DictTrie {
       return false;
     }
     active_node_infos_.push_back(node_info);
-    trie_->InsertNode(node_info.word, &active_node_infos_.back());
+    trie_->InsertNode(WordBegin(node_info), WordEnd(node_info), &active_node_infos_.back());
     return true;
   }
 
+  // with a tag, only deletes the word if it carries that tag
   bool DeleteUserWord(const std::string& word, const std::string& tag = UNKNOWN_TAG) {
-    DictUnit node_info;
-    if (!MakeNodeInfo(node_info, word, user_word_default_weight_, tag)) {
+    Unicode runes;
+    if (!DecodeUTF8RunesInString(word, runes)) {
+      XLOG(ERROR) << "UTF-8 decode failed for dict word: " << word;
       return false;
     }
-    trie_->DeleteNode(node_info.word, &node_info);
+    const DictUnit* unit = trie_->Find(runes.begin(), runes.end());
+    if (unit == NULL || (tag != UNKNOWN_TAG && GetTag(unit) != tag)) {
+      return false;
+    }
+    trie_->DeleteNode(runes, unit);
     return true;
   }
 
@@ -72,6 +137,10 @@ class DictTrie {
     return trie_->Find(begin, end);
   }
 
+  const DictUnit* Find(Unicode::const_iterator begin, Unicode::const_iterator end) const {
+    return trie_->Find(begin, end);
+  }
+
   void Find(RuneStrArray::const_iterator begin,
         RuneStrArray::const_iterator end,
         std::vector<struct Dag>&res,
@@ -79,10 +148,10 @@ class DictTrie {
     trie_->Find(begin, end, res, max_word_len);
   }
 
-  bool Find(const std::string& word)
+  bool Find(const std::string& word) const
   {
     const DictUnit *tmp = NULL;
-    RuneStrArray runes;
+    Unicode runes;
     if (!DecodeUTF8RunesInString(word, runes))
     {
       XLOG(ERROR) << "Decode failed.";
@@ -98,6 +167,74 @@ class DictTrie {
     }
   }
 
+  void GetWord(const DictUnit* unit, std::string& word) const {
+    assert(unit != NULL);
+    limonp::Unicode32ToUtf8(WordBegin(*unit), WordEnd(*unit), word);
+  }
+
+  // runes of a unit owned by this DictTrie, valid until the next insert
+  const Rune* GetRunes(const DictUnit* unit) const {
+    assert(unit != NULL);
+    return WordBegin(*unit);
+  }
+
+  const std::string& GetTag(const DictUnit* unit) const {
+    assert(unit != NULL);
+    return tags_[unit->tag_id];
+  }
+
+  // tag ids only grow: a copy-on-write DictTrie keeps all ids of its base,
+  // so an id means the same tag in every later version
+  const std::string& GetTagName(uint8_t tag_id) const {
+    return tag_id < tags_.size() ? tags_[tag_id] : tags_[0];
+  }
+
+  // 0 (the unknown tag) if the dictionary has no such tag
+  uint8_t FindTagId(const std::string& tag) const {
+    std::unordered_map<std::string, uint8_t>::const_iterator it = tag_ids_.find(tag);
+    return it == tag_ids_.end() ? 0 : it->second;
+  }
+
+  // id of one of the PosTagger special tags, compared by pointer
+  uint8_t SpecialTagId(const char* tag) const {
+    return tag == POS_M ? pos_m_id_ : (tag == POS_ENG ? pos_eng_id_ : pos_x_id_);
+  }
+
+  // stop words that are in the dictionary are flagged on their DictUnit, so
+  // a segmented dictionary word is checked without any hashing. the rest
+  // (punctuation, OOV) go to a rune bitmap or, if longer, a string set.
+  void LoadStopWords(const std::string& filePath) {
+    std::ifstream ifs(filePath.c_str());
+    XCHECK(ifs.is_open()) << "open " << filePath << " failed";
+    std::string line;
+    Unicode runes;
+    while (getline(ifs, line)) {
+      if (line.empty() || !DecodeUTF8RunesInString(line, runes) || runes.empty()) {
+        continue;
+      }
+      const DictUnit* unit = trie_->Find(runes.begin(), runes.end());
+      if (unit != NULL) {
+        // units are owned by this DictTrie, the trie only hands out const pointers
+        const_cast<DictUnit*>(unit)->flags |= DICT_UNIT_STOP_WORD;
+      } else if (runes.size() == 1) {
+        stop_runes_.Insert(runes[0]);
+      } else {
+        stop_words_.insert(line);
+      }
+    }
+  }
+
+  bool IsStopWord(const std::string& sentence, const WordToken& token) const {
+    if (token.unit != NULL) {
+      return (token.unit->flags & DICT_UNIT_STOP_WORD) != 0;
+    }
+    RuneStrLite rp = DecodeUTF8ToRune(sentence.c_str() + token.offset, token.len);
+    if (rp.len == token.len) {
+      return stop_runes_.Contains(rp.rune);
+    }
+    return !stop_words_.empty() && stop_words_.find(sentence.substr(token.offset, token.len)) != stop_words_.end();
+  }
+
   bool IsUserDictSingleChineseWord(const Rune& word) const {
     return IsIn(user_dict_single_chinese_word_, word);
   }
@@ -108,7 +245,7 @@ class DictTrie {
 
   void InserUserDictNode(const std::string& line) {
     std::vector<std::string> buf;
-    DictUnit node_info;
+    DictUnit node_info = DictUnit(); // an empty word is skipped by the trie
     limonp::Split(line, buf, " ");
     if(buf.size() == 1){
           MakeNodeInfo(node_info,
@@ -127,8 +264,8 @@ class DictTrie {
           MakeNodeInfo(node_info, buf[0], weight, buf[2]);
         }
         static_node_infos_.push_back(node_info);
-        if (node_info.word.size() == 1) {
-          user_dict_single_chinese_word_.insert(node_info.word[0]);
+        if (node_info.word_len == 1) {
+          user_dict_single_chinese_word_.insert(*WordBegin(node_info));
         }
   }
 
@@ -178,29 +315,74 @@ class DictTrie {
 
   void CreateTrie(const std::vector<DictUnit>& dictUnits) {
     assert(dictUnits.size());
-    std::vector<Unicode> words;
-    std::vector<const DictUnit*> valuePointers;
+    trie_ = new Trie();
     for (size_t i = 0 ; i < dictUnits.size(); i ++) {
-      words.push_back(dictUnits[i].word);
-      valuePointers.push_back(&dictUnits[i]);
+      trie_->InsertNode(WordBegin(dictUnits[i]), WordEnd(dictUnits[i]), &dictUnits[i]);
     }
+  }
+
+  const Rune* WordBegin(const DictUnit& unit) const {
+    return word_pool_.data() + unit.word_offset;
+  }
+
+  const Rune* WordEnd(const DictUnit& unit) const {
+    return word_pool_.data() + unit.word_offset + unit.word_len;
+  }
 
-    trie_ = new Trie(words, valuePointers);
+  uint8_t InternTag(const std::string& tag) {
+    std::unordered_map<std::string, uint8_t>::const_iterator it = tag_ids_.find(tag);
+    if (it != tag_ids_.end()) {
+      return it->second;
+    }
+    if (tags_.size() > UINT8_MAX) {
+      XLOG(ERROR) << "too many distinct tags, " << tag << " is stored as unknown";
+      return 0;
+    }
+    uint8_t id = uint8_t(tags_.size());
+    tags_.push_back(tag);
+    tag_ids_[tag] = id;
+    return id;
   }
 
   bool MakeNodeInfo(DictUnit& node_info,
         const std::string& word,
         double weight,
         const std::string& tag) {
-    if (!DecodeUTF8RunesInString(word, node_info.word)) {
+    Unicode runes;
+    if (!DecodeUTF8RunesInString(word, runes)) {
       XLOG(ERROR) << "UTF-8 decode failed for dict word: " << word;
       return false;
     }
-    node_info.weight = weight;
-    node_info.tag = tag;
+    if (runes.size() > UINT16_MAX) {
+      XLOG(ERROR) << "dict word too long: " << word;
+      return false;
+    }
+    node_info.word_offset = uint32_t(word_pool_.size());
+    node_info.word_len = uint16_t(runes.size());
+    word_pool_.insert(word_pool_.end(), runes.begin(), runes.end());
+    node_info.weight = float(weight);
+    node_info.tag_id = InternTag(tag);
     return true;
   }
 
+  // append a unit of base to this dictionary unless its word was deleted.
+  // units the base trie no longer resolves to are dropped as well: words
+  // unlinked by DeleteUserWord, and older units shadowed by a re-insert of
+  // the same word (otherwise every rebuild would bring them back).
+  void CopyUnit(const DictTrie& base, const DictUnit& unit, const std::unordered_set<std::string>& deleted) {
+    const Rune* begin = base.WordBegin(unit);
+    if (base.trie_->Find(begin, begin + unit.word_len) != &unit) {
+      return;
+    }
+    if (!deleted.empty() && deleted.count(RunesKey(begin, unit.word_len))) {
+      return;
+    }
+    DictUnit copy = unit;
+    copy.word_offset = uint32_t(word_pool_.size());
+    word_pool_.insert(word_pool_.end(), begin, begin + unit.word_len);
+    static_node_infos_.push_back(copy);
+  }
+
   void LoadDict(const std::string& filePath) {
     std::ifstream ifs(filePath.c_str());
     XCHECK(ifs.is_open()) << "open " << filePath << " failed.";
@@ -260,10 +442,20 @@ class DictTrie {
     }
   }
 
+  static std::string RunesKey(const Rune* runes, size_t len) {
+    return std::string(reinterpret_cast<const char*>(runes), len * sizeof(Rune));
+  }
+
   void Shrink(std::vector<DictUnit>& units) const {
     std::vector<DictUnit>(units.begin(), units.end()).swap(units);
   }
 
+  std::vector<Rune> word_pool_;
+  std::vector<std::string> tags_;
+  std::unordered_map<std::string, uint8_t> tag_ids_;
+  uint8_t pos_m_id_;
+  uint8_t pos_eng_id_;
+  uint8_t pos_x_id_;
   std::vector<DictUnit> static_node_infos_;
   std::deque<DictUnit> active_node_infos_; // must not be std::vector
   Trie * trie_;
@@ -274,6 +466,8 @@ class DictTrie {
   double median_weight_;
   double user_word_default_weight_;
   std::unordered_set<Rune> user_dict_single_chinese_word_;
+  SymbolSet stop_runes_;
+  std::unordered_set<std::string> stop_words_;
 };
 }
 
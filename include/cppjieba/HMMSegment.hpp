@@ -9,6 +9,14 @@
 #include "SegmentBase.hpp"
 
 namespace cppjieba {
+
+// buffers of Viterbi, reusable between calls
+struct ViterbiScratch {
+  vector<size_t> status;
+  vector<int> path;
+  vector<double> weight;
+}; // struct ViterbiScratch
+
 class HMMSegment: public SegmentBase {
  public:
   HMMSegment(const string& filePath)
@@ -44,12 +52,16 @@ class HMMSegment: public SegmentBase {
     GetWordsFromWordRanges(sentence, wrs, words);
   }
   void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res) const {
+    ViterbiScratch scratch;
+    Cut(begin, end, res, scratch);
+  }
+  void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, ViterbiScratch& scratch) const {
     RuneStrArray::const_iterator left = begin;
     RuneStrArray::const_iterator right = begin;
     while (right != end) {
       if (right->rune < 0x80) {
         if (left != right) {
-          InternalCut(left, right, res);
+          InternalCut(left, right, res, scratch);
         }
         left = right;
         do {
@@ -71,7 +83,7 @@ class HMMSegment: public SegmentBase {
       }
     }
     if (left != right) {
-      InternalCut(left, right, res);
+      InternalCut(left, right, res, scratch);
     }
   }
  private:
@@ -111,9 +123,9 @@ class HMMSegment: public SegmentBase {
     }
     return begin;
   }
-  void InternalCut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res) const {
-    vector<size_t> status;
-    Viterbi(begin, end, status);
+  void InternalCut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, ViterbiScratch& scratch) const {
+    vector<size_t>& status = scratch.status;
+    Viterbi(begin, end, scratch);
 
     RuneStrArray::const_iterator left = begin;
     RuneStrArray::const_iterator right;
@@ -129,7 +141,7 @@ class HMMSegment: public SegmentBase {
 
   void Viterbi(RuneStrArray::const_iterator begin, 
         RuneStrArray::const_iterator end, 
-        vector<size_t>& status) const {
+        ViterbiScratch& scratch) const {
     size_t Y = HMMModel::STATUS_SUM;
     size_t X = end - begin;
 
@@ -137,8 +149,10 @@ class HMMSegment: public SegmentBase {
     size_t now, old, stat;
     double tmp, endE, endS;
 
-    vector<int> path(XYSize);
-    vector<double> weight(XYSize);
+    vector<int>& path = scratch.path;
+    vector<double>& weight = scratch.weight;
+    path.resize(XYSize);
+    weight.resize(XYSize);
 
     //start
     for (size_t y = 0; y < Y; y++) {
@@ -174,6 +188,7 @@ class HMMSegment: public SegmentBase {
       stat = HMMModel::S;
     }
 
+    vector<size_t>& status = scratch.status;
     status.resize(X);
     for (int x = X -1 ; x >= 0; x--) {
       status[x] = stat;
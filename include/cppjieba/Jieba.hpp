@@ -1,11 +1,28 @@
 #ifndef CPPJIEAB_JIEBA_H
 #define CPPJIEAB_JIEBA_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include "QuerySegment.hpp"
 #include "KeywordExtractor.hpp"
 
 namespace cppjieba {
 
+// one immutable version of the dictionary together with the segment bound
+// to it. readers hold a DictHandle while they use DictUnit pointers from it;
+// the old version is freed when the last handle goes away.
+struct DictSnapshot {
+  std::shared_ptr<const DictTrie> trie;
+  MixSegment mix_seg;
+  uint64_t version;
+  DictSnapshot(std::shared_ptr<const DictTrie> t, const HMMModel* model, uint64_t v)
+    : trie(t), mix_seg(t.get(), model), version(v) {
+  }
+}; // struct DictSnapshot
+
+typedef std::shared_ptr<const DictSnapshot> DictHandle;
+
 class Jieba {
  public:
   Jieba(const string& dict_path = "", 
@@ -23,6 +40,9 @@ class Jieba {
       extractor(&dict_trie_, &model_, 
                 getPath(idf_path, "idf.utf8"), 
                 getPath(stop_word_path, "stop_words.utf8")) {
+    dict_trie_.LoadStopWords(getPath(stop_word_path, "stop_words.utf8"));
+    // version 0 is the dict_trie_ member itself, it is never freed through the handle
+    Publish(std::shared_ptr<const DictTrie>(&dict_trie_, [](const DictTrie*) {}));
   }
   ~Jieba() {
   }
@@ -34,10 +54,45 @@ class Jieba {
   }; // struct LocWord
 
   void Cut(const string& sentence, vector<string>& words, bool hmm = true) const {
-    mix_seg_.Cut(sentence, words, hmm);
+    AcquireDict()->mix_seg.Cut(sentence, words, hmm);
   }
   void Cut(const string& sentence, vector<Word>& words, bool hmm = true) const {
-    mix_seg_.Cut(sentence, words, hmm);
+    AcquireDict()->mix_seg.Cut(sentence, words, hmm);
+  }
+  // the WordToken APIs below cut with the live dictionary version. DictUnit
+  // pointers in the result stay valid only while that version is alive, so
+  // callers keeping tokens around should pin a version with AcquireDict()
+  // and use the DictHandle overloads.
+  void Cut(const string& sentence, vector<WordToken>& tokens, bool hmm = true) const {
+    AcquireDict()->mix_seg.Cut(sentence, tokens, hmm);
+  }
+  void CutBatch(const vector<string>& sentences, vector<WordToken>& tokens, vector<size_t>& offsets, bool hmm = true) const {
+    AcquireDict()->mix_seg.CutBatch(sentences, tokens, offsets, hmm);
+  }
+  void CutBatch(const DictHandle& dict, const vector<string>& sentences, vector<WordToken>& tokens, vector<size_t>& offsets, SegmentScratch& scratch, bool hmm = true, bool sub_words = false) const {
+    dict->mix_seg.CutBatch(sentences, tokens, offsets, scratch, hmm, sub_words);
+  }
+  void SplitAtSeparators(const DictHandle& dict, const string& sentence, size_t piece_bytes, vector<size_t>& bounds) const {
+    dict->mix_seg.SplitAtSeparators(sentence, piece_bytes, bounds);
+  }
+  bool IsStopWord(const DictHandle& dict, const string& sentence, const WordToken& token) const {
+    return dict->trie->IsStopWord(sentence, token);
+  }
+  // drop stop words from a CutBatch result in place, offsets are kept consistent
+  void RemoveStopWords(const DictHandle& dict, const vector<string>& sentences, vector<WordToken>& tokens, vector<size_t>& offsets) const {
+    const DictTrie* trie = dict->trie.get();
+    size_t out = 0;
+    for (size_t i = 0; i < sentences.size(); i++) {
+      size_t begin = offsets[i];
+      offsets[i] = out;
+      for (size_t j = begin; j < offsets[i + 1]; j++) {
+        if (!trie->IsStopWord(sentences[i], tokens[j])) {
+          tokens[out++] = tokens[j];
+        }
+      }
+    }
+    offsets[sentences.size()] = out;
+    tokens.resize(out);
   }
   void CutAll(const string& sentence, vector<string>& words) const {
     full_seg_.Cut(sentence, words);
@@ -65,26 +120,44 @@ class Jieba {
   }
   
   void Tag(const string& sentence, vector<pair<string, string> >& words) const {
-    mix_seg_.Tag(sentence, words);
+    AcquireDict()->mix_seg.Tag(sentence, words);
   }
   string LookupTag(const string &str) const {
-    return mix_seg_.LookupTag(str);
+    return AcquireDict()->mix_seg.LookupTag(str);
+  }
+  // current dictionary version, lock-free for readers
+  DictHandle AcquireDict() const {
+    return live_.load(std::memory_order_acquire);
   }
+
+  // hot update while other threads are cutting: build a new trie from the
+  // live one on the calling thread, then publish it atomically. cuts that
+  // already hold the old version finish on it. returns the new version.
+  uint64_t UpdateDictionary(const vector<pair<string, string> >& inserts, const vector<string>& deletes) {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    DictHandle current = AcquireDict();
+    std::shared_ptr<const DictTrie> trie(new DictTrie(*current->trie, inserts, deletes));
+    return Publish(trie);
+  }
+
+  // single-word updates are copy-on-write too: the change is applied to a
+  // private copy of the live trie, which is then published. dict_trie_
+  // (version 0) is never modified, so its word pool never moves under readers.
   bool InsertUserWord(const string& word, const string& tag = UNKNOWN_TAG) {
-    return dict_trie_.InsertUserWord(word, tag);
+    return UpdateWith([&](DictTrie& trie) { return trie.InsertUserWord(word, tag); });
   }
 
   bool InsertUserWord(const string& word,int freq, const string& tag = UNKNOWN_TAG) {
-    return dict_trie_.InsertUserWord(word,freq, tag);
+    return UpdateWith([&](DictTrie& trie) { return trie.InsertUserWord(word, freq, tag); });
   }
 
   bool DeleteUserWord(const string& word, const string& tag = UNKNOWN_TAG) {
-    return dict_trie_.DeleteUserWord(word, tag);
+    return UpdateWith([&](DictTrie& trie) { return trie.DeleteUserWord(word, tag); });
   }
   
-  bool Find(const string& word)
+  bool Find(const string& word) const
   {
-    return dict_trie_.Find(word);
+    return AcquireDict()->trie->Find(word);
   }
 
   void ResetSeparators(const string& s) {
@@ -94,6 +167,9 @@ class Jieba {
     mix_seg_.ResetSeparators(s);
     full_seg_.ResetSeparators(s);
     query_seg_.ResetSeparators(s);
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    separators_ = s;
+    Publish(AcquireDict()->trie);
   }
 
   const DictTrie* GetDictTrie() const {
@@ -104,6 +180,8 @@ class Jieba {
     return &model_;
   }
 
+  // the loaders below are NOT safe against concurrent Cut calls and only
+  // affect dict_trie_, call them before serving
   void LoadUserDict(const vector<string>& buf)  {
     dict_trie_.LoadUserDict(buf);
   }
@@ -140,6 +218,27 @@ class Jieba {
     return (pos == string::npos) ? "" : path.substr(0, pos);
   }
 
+  template <class Mutator>
+  bool UpdateWith(Mutator mutate) {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    std::shared_ptr<DictTrie> trie(new DictTrie(*AcquireDict()->trie, vector<pair<string, string> >(), vector<string>()));
+    if (!mutate(*trie)) {
+      return false;
+    }
+    Publish(trie);
+    return true;
+  }
+
+  uint64_t Publish(std::shared_ptr<const DictTrie> trie) {
+    uint64_t version = next_version_++;
+    std::shared_ptr<DictSnapshot> snapshot = std::make_shared<DictSnapshot>(trie, &model_, version);
+    if (!separators_.empty()) {
+      snapshot->mix_seg.ResetSeparators(separators_);
+    }
+    live_.store(snapshot, std::memory_order_release);
+    return version;
+  }
+
   static string getPath(const string& path, const string& default_file) {
     if (path.empty()) {
       string current_dir = getCurrentDirectory();
@@ -160,6 +259,11 @@ class Jieba {
   FullSegment full_seg_;
   QuerySegment query_seg_;
 
+  std::atomic<DictHandle> live_;
+  std::mutex update_mutex_;
+  uint64_t next_version_ = 0;
+  string separators_;
+
  public:
   KeywordExtractor extractor;
 }; // class Jieba
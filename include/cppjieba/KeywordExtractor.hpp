@@ -89,6 +89,12 @@ class KeywordExtractor {
     std::partial_sort(keywords.begin(), keywords.begin() + topN, keywords.end(), Compare);
     keywords.resize(topN);
   }
+
+  // idf of word, words missing from the idf dict get the average like Extract does
+  double GetIdf(const std::string& word) const {
+    std::unordered_map<std::string, double>::const_iterator cit = idfMap_.find(word);
+    return cit != idfMap_.end() ? cit->second : idfAverage_;
+  }
  private:
   void LoadIdfDict(const std::string& idfPath) {
     std::ifstream ifs(idfPath.c_str());
@@ -57,6 +57,14 @@ class MPSegment: public SegmentTagged {
            vector<WordRange>& words,
            size_t max_word_len = MAX_WORD_LENGTH) const {
     vector<Dag> dags;
+    Cut(begin, end, words, dags, max_word_len);
+  }
+  // dags is only scratch space, pass the same vector to avoid reallocating
+  void Cut(RuneStrArray::const_iterator begin,
+           RuneStrArray::const_iterator end,
+           vector<WordRange>& words,
+           vector<Dag>& dags,
+           size_t max_word_len = MAX_WORD_LENGTH) const {
     dictTrie_->Find(begin, 
           end, 
           dags,
@@ -114,10 +122,10 @@ class MPSegment: public SegmentTagged {
     while (i < dags.size()) {
       const DictUnit* p = dags[i].pInfo;
       if (p) {
-        assert(p->word.size() >= 1);
-        WordRange wr(begin + i, begin + i + p->word.size() - 1);
+        assert(p->word_len >= 1);
+        WordRange wr(begin + i, begin + i + p->word_len - 1, p);
         words.push_back(wr);
-        i += p->word.size();
+        i += p->word_len;
       } else { //single chinese word
         WordRange wr(begin + i, begin + i);
         words.push_back(wr);
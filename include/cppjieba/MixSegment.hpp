@@ -6,8 +6,10 @@
 #include "HMMSegment.hpp"
 #include "limonp/StringUtil.hpp"
 #include "PosTagger.hpp"
+#include "Segmenter.hpp"
 
 namespace cppjieba {
+
 class MixSegment: public SegmentTagged {
  public:
   MixSegment(const string& mpSegDict, const string& hmmSegDict, 
@@ -30,61 +32,96 @@ class MixSegment: public SegmentTagged {
     GetStringsFromWords(tmp, words);
   }
   void Cut(const string& sentence, vector<Word>& words, bool hmm = true) const {
-    PreFilter pre_filter(symbols_, sentence);
+    SegmentScratch scratch;
+    PreFilter pre_filter(symbols_, sentence, scratch.runes);
     PreFilter::Range range;
-    vector<WordRange> wrs;
+    vector<WordRange>& wrs = scratch.wrs;
     wrs.reserve(sentence.size() / 2);
     while (pre_filter.HasNext()) {
       range = pre_filter.Next();
-      Cut(range.begin, range.end, wrs, hmm);
+      Cut(range.begin, range.end, wrs, hmm, scratch);
     }
     words.clear();
     words.reserve(wrs.size());
     GetWordsFromWordRanges(sentence, wrs, words);
   }
 
-  void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, bool hmm) const {
-    if (!hmm) {
-      mpSeg_.Cut(begin, end, res);
-      return;
-    }
-    vector<WordRange> words;
-    assert(end >= begin);
-    words.reserve(end - begin);
-    mpSeg_.Cut(begin, end, words);
-
-    vector<WordRange> hmmRes;
-    hmmRes.reserve(end - begin);
-    for (size_t i = 0; i < words.size(); i++) {
-      //if mp Get a word, it's ok, put it into result
-      if (words[i].left != words[i].right || (words[i].left == words[i].right && mpSeg_.IsUserDictSingleChineseWord(words[i].left->rune))) {
-        res.push_back(words[i]);
-        continue;
-      }
+  // no per-word string: dictionary words come back as their DictUnit,
+  // OOV words as byte ranges into sentence.
+  // sub_words: multi-granularity cut, words longer than two runes are
+  // preceded by the dictionary words inside them, read off the same DAG
+  // (see WithSubWords in Segmenter.hpp)
+  void Cut(const string& sentence, vector<WordToken>& tokens, bool hmm = true, bool sub_words = false) const {
+    SegmentScratch scratch;
+    tokens.clear();
+    AppendTokens(sentence, tokens, hmm, sub_words, scratch);
+  }
 
-      // if mp Get a single one and it is not in userdict, collect it in sequence
-      size_t j = i;
-      while (j < words.size() && words[j].left == words[j].right && !mpSeg_.IsUserDictSingleChineseWord(words[j].left->rune)) {
-        j++;
-      }
+  // tokens of sentences[i] are tokens[offsets[i], offsets[i + 1]),
+  // token offsets are relative to sentences[i]
+  void CutBatch(const vector<string>& sentences,
+        vector<WordToken>& tokens,
+        vector<size_t>& offsets,
+        bool hmm = true,
+        bool sub_words = false) const {
+    SegmentScratch scratch;
+    CutBatch(sentences, tokens, offsets, scratch, hmm, sub_words);
+  }
+  void CutBatch(const vector<string>& sentences,
+        vector<WordToken>& tokens,
+        vector<size_t>& offsets,
+        SegmentScratch& scratch,
+        bool hmm = true,
+        bool sub_words = false) const {
+    tokens.clear();
+    offsets.clear();
+    offsets.reserve(sentences.size() + 1);
+    offsets.push_back(0);
+    for (size_t i = 0; i < sentences.size(); i++) {
+      AppendTokens(sentences[i], tokens, hmm, sub_words, scratch);
+      offsets.push_back(tokens.size());
+    }
+  }
 
-      // Cut the sequence with hmm
-      assert(j - 1 >= i);
-      // TODO
-      hmmSeg_.Cut(words[i].left, words[j - 1].left + 1, hmmRes);
-      //put hmm result to result
-      for (size_t k = 0; k < hmmRes.size(); k++) {
-        res.push_back(hmmRes[k]);
+  // byte offsets where a long sentence can be cut into pieces of about
+  // piece_bytes that segment independently: every cut is right after a
+  // separator, so each piece yields exactly the PreFilter ranges it has in
+  // the whole sentence. bounds gets 0, the cuts and sentence.size().
+  void SplitAtSeparators(const string& sentence, size_t piece_bytes, vector<size_t>& bounds) const {
+    bounds.clear();
+    bounds.push_back(0);
+    RuneStrArray runes;
+    if (piece_bytes > 0 && DecodeUTF8RunesInString(sentence, runes)) {
+      size_t piece_begin = 0;
+      for (size_t i = 0; i + 1 < runes.size(); i++) {
+        size_t next = runes[i].offset + runes[i].len;
+        if (next - piece_begin >= piece_bytes && symbols_.Contains(runes[i].rune)) {
+          bounds.push_back(next);
+          piece_begin = next;
+        }
       }
+    }
+    bounds.push_back(sentence.size());
+  }
 
-      //clear tmp vars
-      hmmRes.clear();
-
-      //let i jump over this piece
-      i = j - 1;
+  void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, bool hmm) const {
+    SegmentScratch scratch;
+    Cut(begin, end, res, hmm, scratch);
+  }
+  void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, bool hmm, SegmentScratch& scratch) const {
+    if (hmm) {
+      WithHmm::Cut(mpSeg_, hmmSeg_, begin, end, res, scratch);
+    } else {
+      NoHmm::Cut(mpSeg_, hmmSeg_, begin, end, res, scratch);
     }
   }
 
+  // the same pipeline with its switches fixed at compile time, see Segmenter.hpp
+  template <class HmmPolicy, class FilterPolicy, class OutputPolicy>
+  Segmenter<HmmPolicy, FilterPolicy, OutputPolicy> GetSegmenter() const {
+    return Segmenter<HmmPolicy, FilterPolicy, OutputPolicy>(mpSeg_, hmmSeg_, symbols_);
+  }
+
   const DictTrie* GetDictTrie() const {
     return mpSeg_.GetDictTrie();
   }
@@ -98,6 +135,18 @@ class MixSegment: public SegmentTagged {
   }
 
  private:
+  void AppendTokens(const string& sentence, vector<WordToken>& tokens, bool hmm, bool sub_words, SegmentScratch& scratch) const {
+    if (hmm && sub_words) {
+      GetSegmenter<WithHmm, KeepAll, WithSubWords>().AppendTokens(sentence, tokens, scratch);
+    } else if (hmm) {
+      GetSegmenter<WithHmm, KeepAll, CoarseWords>().AppendTokens(sentence, tokens, scratch);
+    } else if (sub_words) {
+      GetSegmenter<NoHmm, KeepAll, WithSubWords>().AppendTokens(sentence, tokens, scratch);
+    } else {
+      GetSegmenter<NoHmm, KeepAll, CoarseWords>().AppendTokens(sentence, tokens, scratch);
+    }
+  }
+
   MPSegment mpSeg_;
   HMMSegment hmmSeg_;
   PosTagger tagger_;
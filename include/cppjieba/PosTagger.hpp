@@ -8,10 +8,6 @@
 namespace cppjieba {
 using namespace limonp;
 
-static const char* const POS_M = "m";
-static const char* const POS_ENG = "eng";
-static const char* const POS_X = "x";
-
 class PosTagger {
  public:
   PosTagger() {
@@ -31,7 +27,7 @@ class PosTagger {
 
   string LookupTag(const string &str, const SegmentTagged& segment) const {
     const DictUnit *tmp = NULL;
-    RuneStrArray runes;
+    Unicode runes;
     const DictTrie * dict = segment.GetDictTrie();
     assert(dict != NULL);
       if (!DecodeUTF8RunesInString(str, runes)) {
@@ -39,21 +35,30 @@ class PosTagger {
         return POS_X;
       }
       tmp = dict->Find(runes.begin(), runes.end());
-      if (tmp == NULL || tmp->tag.empty()) {
+      if (tmp == NULL || dict->GetTag(tmp).empty()) {
         return SpecialRule(runes);
       } else {
-        return tmp->tag;
+        return dict->GetTag(tmp);
       }
   }
 
  private:
-  const char* SpecialRule(const RuneStrArray& unicode) const {
+  const char* SpecialRule(const Unicode& unicode) const {
+    return SpecialRule(unicode.begin(), unicode.end());
+  }
+
+ public:
+  // tag of a word that has none in the dict, works on Unicode and RuneStrArray ranges
+  template <class RuneIter>
+  static const char* SpecialRule(RuneIter begin, RuneIter end) {
+    size_t size = end - begin;
     size_t m = 0;
     size_t eng = 0;
-    for (size_t i = 0; i < unicode.size() && eng < unicode.size() / 2; i++) {
-      if (unicode[i].rune < 0x80) {
+    for (size_t i = 0; i < size && eng < size / 2; i++) {
+      Rune rune = RuneOf(begin[i]);
+      if (rune < 0x80) {
         eng ++;
-        if ('0' <= unicode[i].rune && unicode[i].rune <= '9') {
+        if ('0' <= rune && rune <= '9') {
           m++;
         }
       }
@@ -70,6 +75,14 @@ class PosTagger {
     return POS_ENG;
   }
 
+ private:
+  static Rune RuneOf(Rune rune) {
+    return rune;
+  }
+  static Rune RuneOf(const RuneStr& runestr) {
+    return runestr.rune;
+  }
+
 }; // class PosTagger
 
 } // namespace cppjieba
@@ -14,13 +14,18 @@ class PreFilter {
     RuneStrArray::const_iterator end;
   }; // struct Range
 
-  PreFilter(const unordered_set<Rune>& symbols, 
+  PreFilter(const SymbolSet& symbols, 
         const string& sentence)
-    : symbols_(symbols) {
-    if (!DecodeUTF8RunesInString(sentence, sentence_)) {
-      XLOG(ERROR) << "UTF-8 decode failed for input sentence"; 
-    }
-    cursor_ = sentence_.begin();
+    : sentence_(own_), symbols_(symbols) {
+    Decode(sentence);
+  }
+  // decode into a caller owned buffer, so its storage can be reused
+  // from one sentence to the next
+  PreFilter(const SymbolSet& symbols, 
+        const string& sentence,
+        RuneStrArray& buffer)
+    : sentence_(buffer), symbols_(symbols) {
+    Decode(sentence);
   }
   ~PreFilter() {
   }
@@ -31,7 +36,7 @@ class PreFilter {
     Range range;
     range.begin = cursor_;
     while (cursor_ != sentence_.end()) {
-      if (IsIn(symbols_, cursor_->rune)) {
+      if (symbols_.Contains(cursor_->rune)) {
         if (range.begin == cursor_) {
           cursor_ ++;
         }
@@ -44,9 +49,17 @@ class PreFilter {
     return range;
   }
  private:
+  void Decode(const string& sentence) {
+    if (!DecodeUTF8RunesInString(sentence, sentence_)) {
+      XLOG(ERROR) << "UTF-8 decode failed for input sentence"; 
+    }
+    cursor_ = sentence_.begin();
+  }
+
   RuneStrArray::const_iterator cursor_;
-  RuneStrArray sentence_;
-  const unordered_set<Rune>& symbols_;
+  RuneStrArray own_;
+  RuneStrArray& sentence_;
+  const SymbolSet& symbols_;
 }; // class PreFilter
 
 } // namespace cppjieba
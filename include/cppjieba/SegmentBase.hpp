@@ -23,22 +23,25 @@ class SegmentBase {
   virtual void Cut(const string& sentence, vector<string>& words) const = 0;
 
   bool ResetSeparators(const string& s) {
-    symbols_.clear();
+    symbols_.Clear();
     RuneStrArray runes;
     if (!DecodeUTF8RunesInString(s, runes)) {
       XLOG(ERROR) << "UTF-8 decode failed for separators: " << s;
       return false;
     }
     for (size_t i = 0; i < runes.size(); i++) {
-      if (!symbols_.insert(runes[i].rune).second) {
+      if (!symbols_.Insert(runes[i].rune)) {
         XLOG(ERROR) << s.substr(runes[i].offset, runes[i].len) << " already exists";
         return false;
       }
     }
     return true;
   }
+  const SymbolSet& GetSeparators() const {
+    return symbols_;
+  }
  protected:
-  unordered_set<Rune> symbols_;
+  SymbolSet symbols_;
 }; // class SegmentBase
 
 } // cppjieba
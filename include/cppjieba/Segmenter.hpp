@@ -0,0 +1,219 @@
+#ifndef CPPJIEBA_SEGMENTER_H
+#define CPPJIEBA_SEGMENTER_H
+
+#include <algorithm>
+#include <cassert>
+#include "MPSegment.hpp"
+#include "HMMSegment.hpp"
+#include "PosTagger.hpp"
+
+namespace cppjieba {
+
+// everything MixSegment allocates while cutting one sentence. CutBatch keeps
+// one of these alive for the whole batch instead of reallocating per line.
+struct SegmentScratch {
+  RuneStrArray runes;
+  vector<WordRange> wrs;
+  vector<WordRange> mp_words;
+  vector<WordRange> hmm_words;
+  vector<Dag> dags;
+  ViterbiScratch viterbi;
+  vector<const DictUnit*> sub_units;
+}; // struct SegmentScratch
+
+// Segmenter<HmmPolicy, FilterPolicy, OutputPolicy> is MixSegment's token
+// pipeline with the per-call switches (hmm on/off, stop word removal,
+// multi-granularity output) fixed at compile time, so a given configuration
+// is one inlined loop without runtime branches or a second filtering pass.
+// MixSegment dispatches its runtime flags to these same instantiations, so
+// both always produce identical tokens.
+
+// HmmPolicy: how one PreFilter range is cut into words.
+struct NoHmm {
+  static void Cut(const MPSegment& mp_seg, const HMMSegment&,
+        RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end,
+        vector<WordRange>& res, SegmentScratch& scratch) {
+    mp_seg.Cut(begin, end, res, scratch.dags);
+  }
+}; // struct NoHmm
+
+struct WithHmm {
+  static void Cut(const MPSegment& mp_seg, const HMMSegment& hmm_seg,
+        RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end,
+        vector<WordRange>& res, SegmentScratch& scratch) {
+    vector<WordRange>& words = scratch.mp_words;
+    words.clear();
+    assert(end >= begin);
+    words.reserve(end - begin);
+    mp_seg.Cut(begin, end, words, scratch.dags);
+
+    vector<WordRange>& hmmRes = scratch.hmm_words;
+    hmmRes.clear();
+    hmmRes.reserve(end - begin);
+    for (size_t i = 0; i < words.size(); i++) {
+      //if mp Get a word, it's ok, put it into result
+      if (words[i].left != words[i].right || (words[i].left == words[i].right && mp_seg.IsUserDictSingleChineseWord(words[i].left->rune))) {
+        res.push_back(words[i]);
+        continue;
+      }
+
+      // if mp Get a single one and it is not in userdict, collect it in sequence
+      size_t j = i;
+      while (j < words.size() && words[j].left == words[j].right && !mp_seg.IsUserDictSingleChineseWord(words[j].left->rune)) {
+        j++;
+      }
+
+      // Cut the sequence with hmm
+      assert(j - 1 >= i);
+      hmm_seg.Cut(words[i].left, words[j - 1].left + 1, hmmRes, scratch.viterbi);
+      //put hmm result to result
+      for (size_t k = 0; k < hmmRes.size(); k++) {
+        res.push_back(hmmRes[k]);
+      }
+
+      //clear tmp vars
+      hmmRes.clear();
+
+      //let i jump over this piece
+      i = j - 1;
+    }
+  }
+}; // struct WithHmm
+
+// FilterPolicy: whether a finished token is kept.
+struct KeepAll {
+  static bool Keep(const DictTrie*, const string&, const WordToken&) {
+    return true;
+  }
+}; // struct KeepAll
+
+// stop words are decided from the DictUnit flag or the stop rune bitmap,
+// the same test as Jieba::RemoveStopWords, just without the second pass
+struct DropStopWords {
+  static bool Keep(const DictTrie* dict, const string& sentence, const WordToken& token) {
+    return !dict->IsStopWord(sentence, token);
+  }
+}; // struct DropStopWords
+
+// OutputPolicy: which tokens one word of the range turns into.
+struct CoarseWords {
+  template <class Seg>
+  static void Emit(const Seg& seg, const string& sentence, RuneStrArray::const_iterator,
+        const WordRange& wr, vector<WordToken>& tokens, SegmentScratch&) {
+    seg.Push(sentence, wr.left, wr.right, wr.unit, false, tokens);
+  }
+}; // struct CoarseWords
+
+// every word longer than two runes is preceded by the 2- and 3-rune
+// dictionary words inside it (the pieces QuerySegment adds), flagged
+// WordToken::sub_word. scratch.dags still holds the DAG of the range wr came
+// from: dags[k].nexts are all dictionary words starting at rune k, so the
+// sub-words are the entries that start and end inside wr. each distinct one
+// is emitted once per coarse word.
+struct WithSubWords {
+  template <class Seg>
+  static void Emit(const Seg& seg, const string& sentence, RuneStrArray::const_iterator range_begin,
+        const WordRange& wr, vector<WordToken>& tokens, SegmentScratch& scratch) {
+    size_t first = wr.left - range_begin;
+    size_t length = wr.Length();
+    scratch.sub_units.clear();
+    for (size_t sub_len = 2; sub_len <= 3 && sub_len < length; sub_len++) {
+      for (size_t k = first; k + sub_len <= first + length; k++) {
+        const Dag& dag = scratch.dags[k];
+        for (size_t j = 0; j < dag.nexts.size(); j++) {
+          const DictUnit* unit = dag.nexts[j].second;
+          if (unit == NULL || dag.nexts[j].first != k + sub_len - 1) {
+            continue;
+          }
+          if (find(scratch.sub_units.begin(), scratch.sub_units.end(), unit) == scratch.sub_units.end()) {
+            scratch.sub_units.push_back(unit);
+            seg.Push(sentence, range_begin + k, range_begin + k + sub_len - 1, unit, true, tokens);
+          }
+          break;
+        }
+      }
+    }
+    seg.Push(sentence, wr.left, wr.right, wr.unit, false, tokens);
+  }
+}; // struct WithSubWords
+
+template <class HmmPolicy, class FilterPolicy, class OutputPolicy>
+class Segmenter {
+ public:
+  // the segments belong to one dictionary version (a MixSegment), which
+  // has to outlive the Segmenter and the DictUnit pointers it hands out
+  Segmenter(const MPSegment& mp_seg, const HMMSegment& hmm_seg, const SymbolSet& symbols)
+    : mpSeg_(mp_seg), hmmSeg_(hmm_seg), symbols_(symbols), dict_(mp_seg.GetDictTrie()) {
+  }
+
+  void Cut(const string& sentence, vector<WordToken>& tokens, SegmentScratch& scratch) const {
+    tokens.clear();
+    AppendTokens(sentence, tokens, scratch);
+  }
+  void Cut(const string& sentence, vector<string>& words, SegmentScratch& scratch) const {
+    vector<WordToken> tokens;
+    Cut(sentence, tokens, scratch);
+    words.clear();
+    words.reserve(tokens.size());
+    for (size_t i = 0; i < tokens.size(); i++) {
+      words.push_back(GetStringFromToken(sentence, tokens[i]));
+    }
+  }
+
+  // tokens of sentences[i] are tokens[offsets[i], offsets[i + 1]),
+  // token offsets are relative to sentences[i]
+  void CutBatch(const vector<string>& sentences,
+        vector<WordToken>& tokens,
+        vector<size_t>& offsets,
+        SegmentScratch& scratch) const {
+    tokens.clear();
+    offsets.clear();
+    offsets.reserve(sentences.size() + 1);
+    offsets.push_back(0);
+    for (size_t i = 0; i < sentences.size(); i++) {
+      AppendTokens(sentences[i], tokens, scratch);
+      offsets.push_back(tokens.size());
+    }
+  }
+
+  void AppendTokens(const string& sentence, vector<WordToken>& tokens, SegmentScratch& scratch) const {
+    PreFilter pre_filter(symbols_, sentence, scratch.runes);
+    PreFilter::Range range;
+    while (pre_filter.HasNext()) {
+      range = pre_filter.Next();
+      scratch.wrs.clear();
+      HmmPolicy::Cut(mpSeg_, hmmSeg_, range.begin, range.end, scratch.wrs, scratch);
+      for (size_t i = 0; i < scratch.wrs.size(); i++) {
+        OutputPolicy::Emit(*this, sentence, range.begin, scratch.wrs[i], tokens, scratch);
+      }
+    }
+  }
+
+  // the POS tag comes with the token: from the DictUnit the DAG already
+  // found for dict words, PosTagger's special rule on the runes at hand for
+  // the rest. only words from the HMM are looked up in the trie (they may
+  // still be dict words), on runes already decoded. same tags as LookupTag.
+  void Push(const string& sentence, RuneStrArray::const_iterator left, RuneStrArray::const_iterator right,
+        const DictUnit* unit, bool sub_word, vector<WordToken>& tokens) const {
+    if (unit == NULL) {
+      unit = dict_->Find(left, right + 1);
+    }
+    uint32_t len = right->offset - left->offset + right->len;
+    uint8_t tag_id = (unit != NULL && unit->tag_id != 0) ? unit->tag_id
+        : dict_->SpecialTagId(PosTagger::SpecialRule(left, right + 1));
+    WordToken token(unit, left->offset, len, tag_id, sub_word);
+    if (FilterPolicy::Keep(dict_, sentence, token)) {
+      tokens.push_back(token);
+    }
+  }
+
+ private:
+  const MPSegment& mpSeg_;
+  const HMMSegment& hmmSeg_;
+  const SymbolSet& symbols_;
+  const DictTrie* dict_;
+}; // class Segmenter
+
+} // namespace cppjieba
+
+#endif
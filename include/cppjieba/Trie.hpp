@@ -12,10 +12,18 @@ using namespace std;
 
 const size_t MAX_WORD_LENGTH = 512;
 
+enum DictUnitFlag {
+  DICT_UNIT_STOP_WORD = 1,
+}; // enum DictUnitFlag
+
+// packed to 12 bytes: the runes live in the owning DictTrie's word pool and
+// the POS tag in its tag table, see DictTrie::GetRunes / DictTrie::GetTag.
 struct DictUnit {
-  Unicode word;
-  double weight;
-  string tag;
+  uint32_t word_offset; // runes are word_pool[word_offset, word_offset + word_len)
+  uint16_t word_len;
+  uint8_t tag_id;
+  uint8_t flags = 0;
+  float weight;         // log probability
 }; // struct DictUnit
 
 // for debugging
@@ -50,6 +58,8 @@ class TrieNode {
 
 class Trie {
  public:
+  Trie(): root_(new TrieNode) {
+  }
   Trie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers)
    : root_(new TrieNode) {
     CreateTrie(keys, valuePointers);
@@ -78,6 +88,26 @@ class Trie {
     return ptNode->ptValue;
   }
 
+  const DictUnit* Find(Unicode::const_iterator begin, Unicode::const_iterator end) const {
+    if (begin == end) {
+      return NULL;
+    }
+
+    const TrieNode* ptNode = root_;
+    TrieNode::NextMap::const_iterator citer;
+    for (Unicode::const_iterator it = begin; it != end; it++) {
+      if (NULL == ptNode->next) {
+        return NULL;
+      }
+      citer = ptNode->next->find(*it);
+      if (ptNode->next->end() == citer) {
+        return NULL;
+      }
+      ptNode = citer->second;
+    }
+    return ptNode->ptValue;
+  }
+
   void Find(RuneStrArray::const_iterator begin, 
         RuneStrArray::const_iterator end, 
         vector<struct Dag>&res, 
@@ -89,6 +119,7 @@ class Trie {
     TrieNode::NextMap::const_iterator citer;
     for (size_t i = 0; i < size_t(end - begin); i++) {
       res[i].runestr = *(begin + i);
+      res[i].nexts.clear(); // res may be a reused buffer
 
       if (root_->next != NULL && root_->next->end() != (citer = root_->next->find(res[i].runestr.rune))) {
         ptNode = citer->second;
@@ -118,13 +149,17 @@ class Trie {
   }
 
   void InsertNode(const Unicode& key, const DictUnit* ptValue) {
-    if (key.begin() == key.end()) {
+    InsertNode(key.begin(), key.end(), ptValue);
+  }
+
+  void InsertNode(const Rune* begin, const Rune* end, const DictUnit* ptValue) {
+    if (begin == end) {
       return;
     }
 
     TrieNode::NextMap::const_iterator kmIter;
     TrieNode *ptNode = root_;
-    for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
+    for (const Rune* citer = begin; citer != end; ++citer) {
       if (NULL == ptNode->next) {
         ptNode->next = new TrieNode::NextMap;
       }
@@ -141,33 +176,46 @@ class Trie {
     assert(ptNode != NULL);
     ptNode->ptValue = ptValue;
   }
-  void DeleteNode(const Unicode& key, const DictUnit* ptValue) {
-      if (key.begin() == key.end()) {
+  // remove key from the trie. the value is detached from the end node, then
+  // nodes that are left without value and children are freed bottom-up.
+  // ptValue is unused: the caller only has a temporary DictUnit.
+  void DeleteNode(const Unicode& key, const DictUnit* /*ptValue*/) {
+    if (key.begin() == key.end()) {
+      return;
+    }
+    vector<TrieNode*> path;
+    path.reserve(key.size() + 1);
+    TrieNode *ptNode = root_;
+    path.push_back(ptNode);
+    for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
+      if (NULL == ptNode->next) {
         return;
       }
-      //定义一个NextMap迭代器
-      TrieNode::NextMap::const_iterator kmIter;
-      //定义一个指向root的TrieNode指针
-      TrieNode *ptNode = root_;
-      for (Unicode::const_iterator citer = key.begin(); citer != key.end(); ++citer) {
-        //链表不存在元素
-        if (NULL == ptNode->next) {
-          return;
-        }
-        kmIter = ptNode->next->find(*citer);
-        //如果map中不存在,跳出循环
-        if (ptNode->next->end() == kmIter) {
-              break;
-        }
-        //从unordered_map中擦除该项
-        ptNode->next->erase(*citer);
-        //删除该node
-        ptNode = kmIter->second;
-        delete ptNode;
+      TrieNode::NextMap::iterator kmIter = ptNode->next->find(*citer);
+      if (ptNode->next->end() == kmIter) {
+        return;
+      }
+      ptNode = kmIter->second;
+      path.push_back(ptNode);
+    }
+    ptNode->ptValue = NULL;
+
+    // path[i] is the child of path[i - 1] through key[i - 1]
+    for (size_t i = path.size() - 1; i > 0; i--) {
+      TrieNode* node = path[i];
+      if (node->ptValue != NULL || (node->next != NULL && !node->next->empty())) {
         break;
       }
-      return;
- }
+      TrieNode* parent = path[i - 1];
+      parent->next->erase(key[i - 1]);
+      delete node->next;
+      delete node;
+      if (parent->next->empty()) {
+        delete parent->next;
+        parent->next = NULL;
+      }
+    }
+  }
  private:
   void CreateTrie(const vector<Unicode>& keys, const vector<const DictUnit*>& valuePointers) {
     if (valuePointers.empty() || keys.empty()) {
@@ -5,9 +5,16 @@
 #include <stdlib.h>
 #include <string>
 #include <vector>
+#include <unordered_set>
 #include <ostream>
 #include "limonp/LocalVector.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 namespace cppjieba {
 
 using std::string;
@@ -28,6 +35,64 @@ struct Word {
   }
 }; // struct Word
 
+// set of runes with a 8KB bitmap for the BMP (all CJK / punctuation we care
+// about), so the per-char separator test is a shift and a mask instead of
+// hashing. runes outside the BMP fall back to a hash set.
+class SymbolSet {
+ public:
+  SymbolSet(): bits_(BMP_SIZE / 64, 0) {
+  }
+  bool Insert(Rune r) {
+    if (Contains(r)) {
+      return false;
+    }
+    if (r < BMP_SIZE) {
+      bits_[r >> 6] |= uint64_t(1) << (r & 63);
+    } else {
+      extra_.insert(r);
+    }
+    size_++;
+    return true;
+  }
+  bool Contains(Rune r) const {
+    if (r < BMP_SIZE) {
+      return (bits_[r >> 6] >> (r & 63)) & 1;
+    }
+    return !extra_.empty() && extra_.find(r) != extra_.end();
+  }
+  void Clear() {
+    bits_.assign(BMP_SIZE / 64, 0);
+    extra_.clear();
+    size_ = 0;
+  }
+  size_t Size() const {
+    return size_;
+  }
+ private:
+  static const Rune BMP_SIZE = 0x10000;
+  vector<uint64_t> bits_;
+  std::unordered_set<Rune> extra_;
+  size_t size_ = 0;
+}; // class SymbolSet
+
+struct DictUnit;
+
+// a segmented word without the substr copy of Word. words found in the
+// dictionary carry their DictUnit (valid as long as the DictTrie is), OOV
+// words (hmm / single char) only carry the byte range in the sentence.
+struct WordToken {
+  const DictUnit* unit;
+  uint32_t offset;
+  uint32_t len;
+  uint8_t tag_id; // POS tag, an id into the DictTrie tag table (see DictTrie::GetTagName)
+  bool sub_word;  // a dictionary word inside the preceding coarse word (multi-granularity cut)
+  WordToken(): unit(NULL), offset(0), len(0), tag_id(0), sub_word(false) {
+  }
+  WordToken(const DictUnit* u, uint32_t o, uint32_t l, uint8_t t = 0, bool sub = false)
+   : unit(u), offset(o), len(l), tag_id(t), sub_word(sub) {
+  }
+}; // struct WordToken
+
 inline std::ostream& operator << (std::ostream& os, const Word& w) {
   return os << "{\"word\": \"" << w.word << "\", \"offset\": " << w.offset << "}";
 }
@@ -59,8 +124,9 @@ typedef limonp::LocalVector<struct RuneStr> RuneStrArray;
 struct WordRange {
   RuneStrArray::const_iterator left;
   RuneStrArray::const_iterator right;
-  WordRange(RuneStrArray::const_iterator l, RuneStrArray::const_iterator r)
-   : left(l), right(r) {
+  const DictUnit* unit; // set when the range is a dictionary word
+  WordRange(RuneStrArray::const_iterator l, RuneStrArray::const_iterator r, const DictUnit* u = NULL)
+   : left(l), right(r), unit(u) {
   }
   size_t Length() const {
     return right - left + 1;
@@ -139,38 +205,120 @@ inline RuneStrLite DecodeUTF8ToRune(const char* str, size_t len) {
   return rp;
 }
 
-inline bool DecodeUTF8RunesInString(const char* s, size_t len, RuneStrArray& runes) {
-  runes.clear();
-  runes.reserve(len / 2);
-  for (uint32_t i = 0, j = 0; i < len;) {
+// length of the leading pure-ASCII run of [s, s + len).
+// scans 32 (AVX2) / 16 (SSE2) bytes per step, the tail byte by byte.
+inline size_t AsciiPrefixLength(const char* s, size_t len) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+    if (_mm256_movemask_epi8(v) != 0) {
+      break;
+    }
+  }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    if (_mm_movemask_epi8(v) != 0) {
+      break;
+    }
+  }
+#endif
+  while (i < len && !(s[i] & 0x80)) {
+    i++;
+  }
+  return i;
+}
+
+// true if the 16 bytes at s start with four well-formed 3-byte sequences
+// (1110xxxx 10xxxxxx 10xxxxxx), i.e. CJK text and fullwidth punctuation.
+// lead and continuation bits of all 12 bytes are checked with one compare;
+// the caller needs 16 readable bytes.
+inline bool IsThreeByteBlock(const char* s) {
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+  const __m128i mask = _mm_setr_epi8(
+    (char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0,
+    (char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0, 0, 0, 0, 0);
+  const __m128i expect = _mm_setr_epi8(
+    (char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80, (char)0x80,
+    (char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80, (char)0x80, 0, 0, 0, 0);
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mask), expect)) == 0xFFFF;
+#else
+  for (int k = 0; k < 12; k += 3) {
+    if (((uint8_t)s[k] & 0xF0) != 0xE0 || ((uint8_t)s[k + 1] & 0xC0) != 0x80 || ((uint8_t)s[k + 2] & 0xC0) != 0x80) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+inline Rune DecodeThreeByteRune(const char* s) {
+  return (Rune((uint8_t)s[0] & 0x0f) << 12) | (Rune((uint8_t)s[1] & 0x3f) << 6) | Rune((uint8_t)s[2] & 0x3f);
+}
+
+// decode [s, s + len) in a single pass. ascii runs are emitted without going
+// through DecodeUTF8ToRune, runs of 3-byte sequences are validated 4 at a
+// time (IsThreeByteBlock) and decoded without per-byte branches, anything
+// else (emoji, 2-byte, malformed) is decoded with the DecodeUTF8ToRune rules.
+// Sink is called as sink(rune, byte_offset, byte_len).
+template <class Sink>
+inline bool DecodeUTF8Runes(const char* s, size_t len, Sink sink) {
+  uint32_t i = 0;
+  while (i < len) {
+    if (!(s[i] & 0x80)) {
+      size_t ascii = AsciiPrefixLength(s + i, len - i);
+      for (size_t end = i + ascii; i < end; i++) {
+        sink(Rune((uint8_t)s[i]), i, 1);
+      }
+      continue;
+    }
+    if (len - i >= 16 && IsThreeByteBlock(s + i)) {
+      for (int k = 0; k < 4; k++, i += 3) {
+        sink(DecodeThreeByteRune(s + i), i, 3);
+      }
+      continue;
+    }
     RuneStrLite rp = DecodeUTF8ToRune(s + i, len - i);
     if (rp.len == 0) {
-      runes.clear();
       return false;
     }
-    RuneStr x(rp.rune, i, rp.len, j, 1);
-    runes.push_back(x);
+    sink(rp.rune, i, rp.len);
     i += rp.len;
-    ++j;
   }
   return true;
 }
 
+inline bool DecodeUTF8RunesInString(const char* s, size_t len, RuneStrArray& runes) {
+  // at most one rune per byte: size once, store without capacity checks
+  runes.resize(len);
+  RuneStr* const out = runes.data();
+  uint32_t j = 0;
+  bool ok = DecodeUTF8Runes(s, len, [out, &j](Rune r, uint32_t offset, uint32_t l) {
+    out[j] = RuneStr(r, offset, l, j, 1);
+    ++j;
+  });
+  runes.resize(ok ? j : 0);
+  return ok;
+}
+
 inline bool DecodeUTF8RunesInString(const string& s, RuneStrArray& runes) {
   return DecodeUTF8RunesInString(s.c_str(), s.size(), runes);
 }
 
+// runes only (4 bytes per char instead of a 20 bytes RuneStr), for callers
+// that never need the byte offsets: dict loading, Find, LookupTag
 inline bool DecodeUTF8RunesInString(const char* s, size_t len, Unicode& unicode) {
-  unicode.clear();
-  RuneStrArray runes;
-  if (!DecodeUTF8RunesInString(s, len, runes)) {
-    return false;
-  }
-  unicode.reserve(runes.size());
-  for (size_t i = 0; i < runes.size(); i++) {
-    unicode.push_back(runes[i].rune);
-  }
-  return true;
+  unicode.resize(len);
+  Rune* const begin = unicode.data();
+  Rune* out = begin;
+  bool ok = DecodeUTF8Runes(s, len, [&out](Rune r, uint32_t, uint32_t) {
+    *out++ = r;
+  });
+  unicode.resize(ok ? out - begin : 0);
+  return ok;
 }
 
 inline bool IsSingleWord(const string& str) {
@@ -215,6 +363,17 @@ inline vector<Word> GetWordsFromWordRanges(const string& s, const vector<WordRan
   return result;
 }
 
+inline void GetTokensFromWordRanges(const vector<WordRange>& wrs, vector<WordToken>& tokens) {
+  for (size_t i = 0; i < wrs.size(); i++) {
+    uint32_t len = wrs[i].right->offset - wrs[i].left->offset + wrs[i].right->len;
+    tokens.push_back(WordToken(wrs[i].unit, wrs[i].left->offset, len));
+  }
+}
+
+inline string GetStringFromToken(const string& s, const WordToken& token) {
+  return s.substr(token.offset, token.len);
+}
+
 inline void GetStringsFromWords(const vector<Word>& words, vector<string>& strs) {
   strs.resize(words.size());
   for (size_t i = 0; i < words.size(); ++i) {
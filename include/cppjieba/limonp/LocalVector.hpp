@@ -51,7 +51,10 @@ class LocalVector {
   };
  public:
   LocalVector<T>& operator = (const LocalVector<T>& vec) {
-    clear();
+    if(this == &vec) {
+      return *this;
+    }
+    release_();
     size_ = vec.size();
     capacity_ = vec.capacity();
     if(vec.buffer_ == vec.ptr_) {
@@ -70,6 +73,12 @@ class LocalVector {
     size_ = 0;
     capacity_ = LOCAL_VECTOR_BUFFER_SIZE;
   }
+  void release_() {
+    if(ptr_ != buffer_) {
+      free(ptr_);
+    }
+    init_();
+  }
  public:
   T& operator [] (size_t i) {
     return ptr_[i];
@@ -113,11 +122,19 @@ class LocalVector {
   const_iterator end() const {
     return ptr_ + size_;
   }
+  // like std::vector::clear, keeps the heap buffer so a reused vector
+  // (decode buffers, dag nexts) does not malloc again
   void clear() {
-    if(ptr_ != buffer_) {
-      free(ptr_);
-    }
-    init_();
+    size_ = 0;
+  }
+  // no value-initialization (T is primitive): grow with resize(n), fill
+  // through data(), then resize() down to what was actually written
+  void resize(size_t size) {
+    reserve(size);
+    size_ = size;
+  }
+  T* data() {
+    return ptr_;
   }
 };
 
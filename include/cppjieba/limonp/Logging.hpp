@@ -6,6 +6,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <ctime>
+#include <atomic>
 
 #ifdef XLOG
 #error "XLOG has been defined already"
@@ -30,6 +31,20 @@ enum {
 static const char * LOG_LEVEL_ARRAY[] = {"DEBUG","INFO","WARN","ERROR","FATAL"};
 static const char * LOG_TIME_FORMAT = "%Y-%m-%d %H:%M:%S";
 
+// the host application can take over output: finished records are handed
+// to the sink instead of being written to stderr. the sink must not return
+// for LL_FATAL before the record is out, abort() follows right after.
+typedef void (*LogSink)(size_t level, const std::string& message);
+
+inline std::atomic<LogSink>& LogSinkSlot() {
+  static std::atomic<LogSink> sink(NULL);
+  return sink;
+}
+
+inline void SetLogSink(LogSink sink) {
+  LogSinkSlot().store(sink);
+}
+
 class Logger {
  public:
   Logger(size_t level, const char* filename, int lineno)
@@ -72,7 +87,12 @@ class Logger {
        return;
      }
 #endif
-    std::cerr << stream_.str() << std::endl;
+    LogSink sink = LogSinkSlot().load();
+    if (sink != NULL) {
+      sink(level_, stream_.str());
+    } else {
+      std::cerr << stream_.str() << std::endl;
+    }
     if (level_ == LL_FATAL) {
       abort();
     }
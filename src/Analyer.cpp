@@ -1,4 +1,6 @@
 #include "Analyzer.h"
+#include "WriteAheadLog.h"
+#include <cmath>
 
 /*
     构造函数，构造一次jieba对象
@@ -9,10 +11,43 @@ Analyzer::Analyzer
     const std::string& user_dict_path, 
     const std::string& idf_path, 
     const std::string& stop_word_path):
-jieba_(dict_path, hmm_path, user_dict_path, idf_path, stop_word_path){
+jieba_(std::make_shared<cppjieba::Jieba>(dict_path, hmm_path, user_dict_path, idf_path, stop_word_path)),
+tokenizer_(MakeTokenizer(tokenizer_kind_, multi_granularity_)){
     
 }
 
+/*
+    频道用的构造函数：和别的 Analyzer 共用同一个 jieba（词典、HMM 模型只加载一次），
+    自己只有统计数据，内存随这个频道出现过的词增长
+*/
+Analyzer::Analyzer(std::shared_ptr<cppjieba::Jieba> jieba):
+jieba_(std::move(jieba)),
+tokenizer_(MakeTokenizer(tokenizer_kind_, multi_granularity_)){
+
+}
+
+std::shared_ptr<cppjieba::Jieba> Analyzer::GetSharedJieba() const {
+    return jieba_;
+}
+
+/*
+    照搬 other 的配置（分词后端、词性过滤、多粒度、IDF 来源、注册的窗口），新建频道时用，统计数据不复制
+*/
+void Analyzer::CopyConfigFrom(const Analyzer& other) {
+    std::vector<std::pair<std::string, long long>> windows;
+    {
+        std::shared_lock<std::shared_mutex> lock(other.mutex_);
+        pos_classes_ = other.pos_classes_;
+        multi_granularity_ = other.multi_granularity_;
+        tokenizer_kind_ = other.tokenizer_kind_;
+        idf_source_ = other.idf_source_;
+        hot_duration_ms_ = other.hot_duration_ms_;
+        for (const auto& win : other.extra_windows_) windows.emplace_back(win.name, win.duration_ms);
+    }
+    tokenizer_ = MakeTokenizer(tokenizer_kind_, multi_granularity_);
+    for (const auto& w : windows) AddWindow(w.first, w.second);
+}
+
 
 /*  注意：这个函数已被弃用，没有被实际使用，所以没有写入文档内，其用于在全局内插入
     1. 调用Utils解析时间戳，解析实际内容
@@ -36,7 +71,7 @@ void Analyzer::Ingest(const std::string& line){
 
     // 2. 分词（无锁）
     std::vector<std::string> words;
-    jieba_.Cut(content, words, true);
+    jieba_->Cut(content, words, true);
 
     // 3. 写锁，分完词要写入了
     std::unique_lock<std::shared_mutex> lock(mutex_);
@@ -123,22 +158,129 @@ void Analyzer::UpdateRankingSet(std::set<std::pair<int, std::string>>& rank_set,
 }
 
 /*
-    线程安全的分词接口
+    线程安全的分词接口，走当前配置的分词后端（不去停用词）
 */
 void Analyzer::Split(const std::string& sentence, std::vector<std::string>& words) const {
     // std::cout << "Debug from Spilt: curr sentencev" << sentence << std::endl;
-    jieba_.Cut(sentence, words, true);
+    std::vector<cppjieba::WordToken> tokens;
+    Split(sentence, tokens);
+    words.clear();
+    words.reserve(tokens.size());
+    for (const auto& t : tokens) {
+        words.push_back(cppjieba::GetStringFromToken(sentence, t));
+    }
+}
+
+/*
+    线程安全的分词接口（返回 WordToken）
+    词典内的词只带 DictUnit 指针，未登录词只带字节区间，不产生任何 string
+*/
+void Analyzer::Split(const std::string& sentence, std::vector<cppjieba::WordToken>& tokens) const {
+    cppjieba::DictHandle dict = jieba_->AcquireDict();
+    cppjieba::SegmentScratch scratch;
+    std::vector<std::string> one(1, sentence);
+    std::vector<std::size_t> offsets;
+    tokenizer_->CutBatch(dict, one, tokens, offsets, scratch, false);
+}
+
+/*
+    批量分词：sentences[i] 的结果为 tokens[offsets[i], offsets[i+1])
+    scratch 由调用方（每个 worker 一个）持有，整批复用，不再每行重新分配
+    停用词在这里就被去掉（词典词查 DictUnit 标记位，其余查位图），不会进入缓存和计数
+    dict 是调用方固定住的词典版本，结果里的 DictUnit 指针属于这个版本
+    jieba 后端的每种配置都是编译期确定的 Segmenter（见 Tokenizer.h），整批只有一次虚调用
+    多粒度模式下长词前面会带上它里面的词典词（sub_word 标记），从同一次 DAG 里取出，不用再分一遍
+*/
+void Analyzer::SplitBatch(const cppjieba::DictHandle& dict, const std::vector<std::string>& sentences,
+                          std::vector<cppjieba::WordToken>& tokens, std::vector<std::size_t>& offsets,
+                          cppjieba::SegmentScratch& scratch) const {
+    tokenizer_->CutBatch(dict, sentences, tokens, offsets, scratch, true);
+}
+
+/*
+    超长行切段：只在分隔符之后切，各段分别分词再拼起来和整行分词结果完全一致
+    bounds 为 [0, 切点..., sentence.size()]，第 i 段是 [bounds[i], bounds[i+1])
+*/
+void Analyzer::FindSplitPoints(const cppjieba::DictHandle& dict, const std::string& sentence, std::size_t piece_bytes,
+                               std::vector<std::size_t>& bounds) const {
+    jieba_->SplitAtSeparators(dict, sentence, piece_bytes, bounds);
+}
+
+/*
+    词典词转回字符串，只在提交批次时对每个不同的词调用一次
+    DictUnit 里存的是它所在版本词池里的偏移，必须用切出它的那个版本解码
+*/
+void Analyzer::GetWord(const cppjieba::DictHandle& dict, const cppjieba::DictUnit* unit, std::string& word) const {
+    dict->trie->GetWord(unit, word);
+}
+
+/*
+    词典热更新（RCU）：
+    新词典在调用线程上从当前版本复制构建，构建期间分词照常进行；
+    构建完成后原子替换，正在用旧版本的 worker 用完（释放 DictHandle）后旧版本自动回收
+*/
+cppjieba::DictHandle Analyzer::AcquireDict() const {
+    return jieba_->AcquireDict();
+}
+
+uint64_t Analyzer::UpdateDictionary(const std::vector<std::pair<std::string, std::string>>& inserts,
+                                    const std::vector<std::string>& deletes) {
+    return jieba_->UpdateDictionary(inserts, deletes);
+}
+
+/*
+    按词性计数：词性 id 是词典标签表的下标，表只增不减，同一个名字在各个版本里 id 相同；
+    词典里还没有的词性名直接忽略（不能落到 0 号"未知"上）
+*/
+void Analyzer::SetPosClasses(const std::vector<std::string>& tags) {
+    pos_classes_ = tags;
+}
+
+void Analyzer::SetMultiGranularity(bool enabled) {
+    multi_granularity_ = enabled;
+    tokenizer_ = MakeTokenizer(tokenizer_kind_, multi_granularity_);
+}
+
+/*
+    切换分词后端（jieba Mix / 只走 MP / 空白切分 / 二元字组），需在处理开始前设置
+    后两种是给聚合层压测用的假分词，编译时定义 BENCHMARK_MOCK_JIEBA 则默认用空白切分
+*/
+void Analyzer::SetTokenizer(TokenizerKind kind) {
+    tokenizer_kind_ = kind;
+    tokenizer_ = MakeTokenizer(tokenizer_kind_, multi_granularity_);
+}
+
+const char* Analyzer::GetTokenizerName() const {
+    return tokenizer_->Name();
+}
+
+bool Analyzer::GetPosFilter(const cppjieba::DictHandle& dict, std::bitset<256>& filter) const {
+    if (pos_classes_.empty()) return false;
+    filter.reset();
+    for (const auto& tag : pos_classes_) {
+        uint8_t id = dict->trie->FindTagId(tag);
+        if (id != 0) filter.set(id);
+    }
+    return true;
 }
 
 /*
     批量写入和更新
 */
-void Analyzer::IngestBatch(const std::unordered_map<std::string, int>& local_counts, long long timestamp) {
+void Analyzer::IngestBatch(const std::unordered_map<std::string, int>& local_counts, long long timestamp,
+                           const std::unordered_map<std::string, uint8_t>* tags) {
     if (local_counts.empty()) return;
 
     // 1. 加写锁
     std::unique_lock<std::shared_mutex> lock(mutex_);
 
+    // 词性只记第一次见到的（同一个词在词典里的词性是固定的）
+    if (tags != nullptr) {
+        for (const auto& kv : *tags) {
+            word_tags_.emplace(kv.first, kv.second);
+        }
+    }
+
     // 2. 计算当前批次的时间戳 (对齐到秒)
     long long bucket_time = (timestamp / 1000) * 1000;
 
@@ -180,6 +322,14 @@ void Analyzer::IngestBatch(const std::unordered_map<std::string, int>& local_cou
             if (insert_index <= window_start_index_) {
                 window_start_index_++;
             }
+            // 其它窗口同理；插在起始桶正前方且仍在窗口期内的，新桶就是窗口的第一个桶
+            for (auto& win : extra_windows_) {
+                if (insert_index < win.start_index ||
+                    (insert_index == win.start_index &&
+                     bucket_time < history_buckets_.back().bucket_start_time - win.duration_ms)) {
+                    win.start_index++;
+                }
+            }
         }
     }
 
@@ -205,11 +355,21 @@ void Analyzer::IngestBatch(const std::unordered_map<std::string, int>& local_cou
             int new_c = old_c + count_inc;
             global_counts_[w] = new_c;
             UpdateRankingSet(ranking_set_, w, old_c, new_c);
+            global_total_ += count_inc;
         }
 
         // 3. 更新窗口 (仅当在窗口期内时更新)
         if (is_in_window) {
             window_counts_[w] += count_inc;
+            UpdateWindowScore(w);
+        }
+
+        // 4. 更新其它窗口：每个窗口一次计数 + 一次排名调整
+        for (auto& win : extra_windows_) {
+            if (bucket_time < current_latest_time - win.duration_ms) continue;
+            int& c = win.counts[w];
+            UpdateRankingSet(win.ranking, w, c, c + count_inc);
+            c += count_inc;
         }
     }
 
@@ -233,6 +393,7 @@ void Analyzer::IngestBatch(const std::unordered_map<std::string, int>& local_cou
                     } else {
                         window_counts_[w] = new_c;
                     }
+                    UpdateWindowScore(w);
                 }
             }
             window_start_index_++;
@@ -240,6 +401,326 @@ void Analyzer::IngestBatch(const std::unordered_map<std::string, int>& local_cou
             break;
         }
     }
+
+    for (auto& win : extra_windows_) {
+        ExpireWindow(win, current_latest_time);
+    }
+
+    // 步骤 D: 背景语料模式下定期刷新 IDF 的总量部分（要重排整个窗口，所以不每批都做）
+    if (idf_source_ == IdfSource::Background &&
+        current_latest_time - last_idf_refresh_time_ >= IDF_REFRESH_INTERVAL_MS) {
+        last_idf_refresh_time_ = current_latest_time;
+        RebuildWindowScores();
+    }
+
+    // 步骤 E: 记日志（只进内存缓冲，由提交线程批量写盘），提交计数加一，读接口的响应缓存据此判断是否过期
+    if (wal_ != nullptr) wal_->Append(bucket_time, local_counts, tags);
+    data_version_.fetch_add(1, std::memory_order_release);
+}
+
+/*
+    和步骤 C 一样：从起始桶开始，把早于 (最新时间 - 窗口长度) 的桶减掉。调用方需持有写锁
+*/
+void Analyzer::ExpireWindow(SlidingWindow& window, long long latest_time) {
+    long long expire_threshold = latest_time - window.duration_ms;
+    while (window.start_index < history_buckets_.size() &&
+           history_buckets_[window.start_index].bucket_start_time < expire_threshold) {
+        for (const auto& kv : history_buckets_[window.start_index].word_counts) {
+            auto it = window.counts.find(kv.first);
+            if (it == window.counts.end()) continue;
+            int new_c = it->second - kv.second;
+            UpdateRankingSet(window.ranking, kv.first, it->second, new_c);
+            if (new_c <= 0) window.counts.erase(it);
+            else it->second = new_c;
+        }
+        window.start_index++;
+    }
+}
+
+/*
+    注册窗口。处理开始前调用；已有数据时从历史桶里把窗口内的部分补算出来
+*/
+void Analyzer::AddWindow(const std::string& name, long long duration_ms) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& win : extra_windows_) {
+        if (win.name == name) return;
+    }
+    SlidingWindow win;
+    win.name = name;
+    win.duration_ms = duration_ms;
+    if (!history_buckets_.empty()) {
+        long long expire_threshold = history_buckets_.back().bucket_start_time - duration_ms;
+        auto it = std::lower_bound(history_buckets_.begin(), history_buckets_.end(), expire_threshold,
+            [](const TimeBucket& bucket, long long val) {
+                return bucket.bucket_start_time < val;
+            });
+        win.start_index = std::distance(history_buckets_.begin(), it);
+        for (; it != history_buckets_.end(); ++it) {
+            for (const auto& kv : it->word_counts) win.counts[kv.first] += kv.second;
+        }
+        for (const auto& kv : win.counts) win.ranking.insert({kv.second, kv.first});
+    }
+    extra_windows_.push_back(std::move(win));
+    data_version_.fetch_add(1, std::memory_order_release);
+}
+
+const SlidingWindow* Analyzer::FindWindow(const std::string& name) const {
+    for (const auto& win : extra_windows_) {
+        if (win.name == name) return &win;
+    }
+    return nullptr;
+}
+
+bool Analyzer::HasWindow(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return FindWindow(name) != nullptr;
+}
+
+/*
+    注册窗口的 TopK，排名随写入和过期增量维护，这里只取前 K 个
+*/
+std::vector<std::pair<std::string, int>> Analyzer::GetWindowTopK(const std::string& name, int k) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::vector<std::pair<std::string, int>> ans;
+    const SlidingWindow* win = FindWindow(name);
+    if (win == nullptr) return ans;
+    auto it = win->ranking.rbegin();
+    for (int i = 0; i < k && it != win->ranking.rend(); ++i, ++it) {
+        ans.push_back({it->second, it->first});
+    }
+    return ans;
+}
+
+/*
+    TF-IDF 的 IDF：
+    - Static: 直接查 idf.utf8，查不到用平均值（和 KeywordExtractor 一致）
+    - Background: log((T + 1) / (g + 1))，g 是该词的全局词频，T 是全局总词频。
+      g 每次更新该词时都是最新的；T 冻结在 background_log_total_ 里定期刷新，
+      否则每来一批数据所有词的分数都会变，没法增量维护
+    调用方需持有写锁
+*/
+double Analyzer::GetIdf(const std::string& word) const {
+    if (idf_source_ == IdfSource::Static) {
+        return jieba_->extractor.GetIdf(word);
+    }
+    auto it = global_counts_.find(word);
+    int g = it == global_counts_.end() ? 0 : it->second;
+    return std::max(0.0, background_log_total_ - std::log((double)g + 1.0));
+}
+
+void Analyzer::UpdateWindowScore(const std::string& word) {
+    auto old_it = window_scores_.find(word);
+    if (old_it != window_scores_.end()) {
+        window_tfidf_ranking_.erase({old_it->second, word});
+    }
+    auto count_it = window_counts_.find(word);
+    if (count_it == window_counts_.end()) {
+        if (old_it != window_scores_.end()) window_scores_.erase(old_it);
+        return;
+    }
+    double score = count_it->second * GetIdf(word);
+    window_scores_[word] = score;
+    window_tfidf_ranking_.insert({score, word});
+}
+
+void Analyzer::RebuildWindowScores() {
+    background_log_total_ = std::log((double)global_total_ + 1.0);
+    window_tfidf_ranking_.clear();
+    window_scores_.clear();
+    for (const auto& kv : window_counts_) {
+        double score = kv.second * GetIdf(kv.first);
+        window_scores_[kv.first] = score;
+        window_tfidf_ranking_.insert({score, kv.first});
+    }
+}
+
+void Analyzer::SetIdfSource(IdfSource source) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    idf_source_ = source;
+    RebuildWindowScores();
+    data_version_.fetch_add(1, std::memory_order_release);
+}
+
+/*
+    10 分钟窗口内某个词性的 TopK（比如只看人名 nr、机构名 nt）
+*/
+std::vector<std::pair<std::string, int>> Analyzer::GetLast10MinTopKByPos(const std::string& pos, int k) {
+    uint8_t tag_id = jieba_->AcquireDict()->trie->FindTagId(pos);
+    if (tag_id == 0) return {};
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<std::pair<int, std::string>> temp_vec;
+    for (const auto& kv : window_counts_) {
+        auto it = word_tags_.find(kv.first);
+        if (it != word_tags_.end() && it->second == tag_id) {
+            temp_vec.push_back({kv.second, kv.first});
+        }
+    }
+
+    k = std::max(0, std::min(k, (int)temp_vec.size())); // k 来自 URL 参数，负数时 partial_sort 越界
+    std::partial_sort(temp_vec.begin(), temp_vec.begin() + k, temp_vec.end(),
+        [](const std::pair<int, std::string>& a, const std::pair<int, std::string>& b) {
+            if (a.first != b.first) return a.first > b.first;
+            return a.second < b.second;
+        });
+
+    std::vector<std::pair<std::string, int>> ans;
+    ans.reserve(k);
+    for (int i = 0; i < k; ++i) {
+        ans.push_back({temp_vec[i].second, temp_vec[i].first});
+    }
+    return ans;
+}
+
+/*
+    共现边直接交给共现图，图有自己的锁，不和词频统计抢 mutex_
+*/
+void Analyzer::IngestEdges(const std::vector<WordEdge>& edges, long long timestamp) {
+    graph_.AddEdges(edges, timestamp);
+    data_version_.fetch_add(1, std::memory_order_release);
+}
+
+void Analyzer::AttachWal(WriteAheadLog* wal) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    wal_ = wal;
+}
+
+void Analyzer::VisitState(const std::function<void(const StateView&)>& visitor) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    StateView view{history_buckets_, sealing_, word_tags_, {}};
+    if (cold_) {
+        for (const auto& segment : cold_->Segments()) view.cold_segments.push_back(segment->Name());
+    }
+    visitor(view);
+}
+
+/*
+    冷存储：热数据至少保留 hot_duration_ms，且不短于最长的窗口（窗口内的桶要随时能减掉）
+    CopyConfigFrom 会带上 hot_duration_ms，频道用自己的目录再调一次
+*/
+void Analyzer::EnableColdArchive(const std::string& dir, long long hot_duration_ms) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    cold_ = std::make_unique<ColdArchive>(dir);
+    hot_duration_ms_ = hot_duration_ms;
+}
+
+/*
+    段里的桶不会再回到内存，但全局词频要包含它们：按各段的汇总列加回 global_counts_
+*/
+bool Analyzer::RestoreColdArchive(const std::vector<std::string>& segments) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!cold_) {
+        if (!segments.empty()) LOG(WARN) << "[Cold] Snapshot references " << segments.size()
+                                         << " cold segments but cold storage is off; their history is ignored";
+        return segments.empty();
+    }
+    bool ok = cold_->Restore(segments);
+    for (const auto& segment : cold_->Segments()) {
+        segment->ForEachTotal([this](std::string_view word, long long total) {
+            std::string w(word);
+            int old_c = global_counts_[w];
+            int new_c = SaturatingAddCount(old_c, total);
+            global_counts_[w] = new_c;
+            UpdateRankingSet(ranking_set_, w, old_c, new_c);
+            global_total_ += total;
+            return true;
+        });
+    }
+    background_log_total_ = std::log((double)global_total_ + 1.0);
+    data_version_.fetch_add(1, std::memory_order_release);
+    return ok;
+}
+
+long long Analyzer::GetHotDuration() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return cold_ ? hot_duration_ms_ : -1;
+}
+
+bool Analyzer::GetColdStats(std::size_t& segments, std::size_t& buckets, std::size_t& bytes) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (!cold_) return false;
+    segments = cold_->Segments().size();
+    buckets = 0;
+    bytes = 0;
+    for (const auto& segment : cold_->Segments()) {
+        buckets += segment->BucketCount();
+        bytes += segment->FileBytes();
+    }
+    return true;
+}
+
+/*
+    冷热分层，分三步，只有前后两步短暂持写锁：
+    1. 写锁内把够老的桶从 history_buckets_ 前端移进 sealing_，修正各窗口的起始下标
+    2. 出锁编码、写段文件（sealing_ 只有这里会改，查询只读，可以并发）
+    3. 写锁内把新段加进段列表、清空 sealing_，查询从此改读段文件
+    写失败时桶留在 sealing_ 里，下次重试（快照也会带上它们）
+    之后迟到的、比段里的桶还老的数据会在 history_buckets_ 最前面开新桶，下一轮再进冷存储
+*/
+std::size_t Analyzer::ArchiveColdBuckets() {
+    const std::size_t MAX_BUCKETS_PER_SEGMENT = 3600;
+    if (!cold_) return 0;
+    std::size_t archived = 0;
+    while (true) {
+        std::size_t n = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (sealing_.empty()) {
+                if (history_buckets_.empty()) break;
+                long long horizon = std::max(hot_duration_ms_, WINDOW_DURATION_MS);
+                std::size_t limit = std::min(window_start_index_, MAX_BUCKETS_PER_SEGMENT);
+                for (const auto& win : extra_windows_) {
+                    horizon = std::max(horizon, win.duration_ms);
+                    limit = std::min(limit, win.start_index);
+                }
+                long long cut_time = history_buckets_.back().bucket_start_time - horizon;
+                while (n < limit && history_buckets_[n].bucket_start_time < cut_time) ++n;
+                if (n == 0) break;
+                sealing_.assign(std::make_move_iterator(history_buckets_.begin()),
+                                std::make_move_iterator(history_buckets_.begin() + n));
+                history_buckets_.erase(history_buckets_.begin(), history_buckets_.begin() + n);
+                window_start_index_ -= n;
+                for (auto& win : extra_windows_) win.start_index -= n;
+            }
+            n = sealing_.size();
+        }
+
+        std::shared_ptr<const ColdSegment> segment = cold_->Seal(sealing_);
+        if (!segment) break;
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        cold_->Add(std::move(segment));
+        sealing_.clear();
+        archived += n;
+    }
+    if (archived > 0) {
+        LOG(INFO) << "[Cold] Archived " << archived << " buckets to " << cold_->Dir();
+    }
+    return archived;
+}
+
+uint64_t Analyzer::GetDataVersion() const {
+    return data_version_.load(std::memory_order_acquire);
+}
+
+std::vector<std::pair<std::string, double>> Analyzer::GetTopTopics(int k) {
+    return graph_.GetTopTopics(k);
+}
+
+/*
+    10 分钟窗口内按 TF-IDF 排名的热词，排名随写入增量维护，这里只取前 K 个
+*/
+std::vector<KeywordItem> Analyzer::GetLast10MinKeywords(int k) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::vector<KeywordItem> ans;
+    auto it = window_tfidf_ranking_.rbegin();
+    for (int i = 0; i < k && it != window_tfidf_ranking_.rend(); ++i, ++it) {
+        auto count_it = window_counts_.find(it->second);
+        ans.push_back({it->second, count_it == window_counts_.end() ? 0 : count_it->second, it->first});
+    }
+    return ans;
 }
 
 std::vector<std::pair<std::string, int>> Analyzer::GetLast10MinTopK(int k) {
@@ -258,7 +739,7 @@ std::vector<std::pair<std::string, int>> Analyzer::GetLast10MinTopK(int k) {
     }
 
     // 4. 确定 K 的有效范围
-    if (k > (int)temp_vec.size()) k = temp_vec.size();
+    k = std::max(0, std::min(k, (int)temp_vec.size()));
 
     // 5. 部分排序 (O(N * log K)) - 只排前 K 个
     std::partial_sort(temp_vec.begin(), temp_vec.begin() + k, temp_vec.end(),
@@ -280,9 +761,6 @@ std::vector<std::pair<std::string, int>> Analyzer::GetLast10MinTopK(int k) {
 
 std::vector<std::pair<std::string, int>> Analyzer::GetTopKInTimeRange(long long start_ts, long long end_ts, int k) {
     std::shared_lock<std::shared_mutex> lock(mutex_); 
-    
-    // 如果历史为空，直接返回
-    if (history_buckets_.empty()) return {};
 
     std::unordered_map<std::string, int> range_counts;
 
@@ -305,6 +783,22 @@ std::vector<std::pair<std::string, int>> Analyzer::GetTopKInTimeRange(long long
         }
     }
 
+    // 冷数据：正在写段文件的桶，和时间上有交集的段（其余的段按文件头的时间范围直接跳过）
+    std::vector<std::shared_ptr<const ColdSegment>> segments;
+    if (cold_) {
+        for (const auto& bucket : sealing_) {
+            if (bucket.bucket_start_time < start_ts || bucket.bucket_start_time > end_ts) continue;
+            for (const auto& kv : bucket.word_counts) {
+                range_counts[kv.first] += kv.second;
+            }
+        }
+        cold_->Overlapping(start_ts, end_ts, segments);
+    }
+    lock.unlock(); // 段文件只读，拿到 shared_ptr 后不用再持锁
+    for (const auto& segment : segments) {
+        segment->AddRange(start_ts, end_ts, range_counts);
+    }
+
     if (range_counts.empty()) return {};
 
     std::vector<std::pair<int, std::string>> temp_vec;
@@ -314,7 +808,7 @@ std::vector<std::pair<std::string, int>> Analyzer::GetTopKInTimeRange(long long
     }
 
     // 防 k 越界
-    if (k > (int)temp_vec.size()) k = temp_vec.size();
+    k = std::max(0, std::min(k, (int)temp_vec.size()));
 
     // Partial Sort (Top K)
     std::partial_sort(temp_vec.begin(), temp_vec.begin() + k, temp_vec.end(),
@@ -336,15 +830,11 @@ std::vector<std::pair<std::string, int>> Analyzer::GetTopKInTimeRange(long long
 */
 void Analyzer::DebugPrint() {
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    std::cout << "=== Analyzer State ===" << std::endl;
-    std::cout << "Total Buckets: " << history_buckets_.size() << std::endl;
-    std::cout << "Global Unique Words: " << global_counts_.size() << std::endl;
-    std::cout << "Window (10min) Unique Words: " << window_counts_.size() << std::endl;
-    std::cout << "Window Start Index: " << window_start_index_ << std::endl;
-    if (!history_buckets_.empty()) {
-        std::cout << "Latest Bucket Time: " << history_buckets_.back().bucket_start_time << " ms" << std::endl;
-    }
-    std::cout << "======================" << std::endl;
+    LOG(INFO) << "[Analyzer] State: buckets=" << history_buckets_.size()
+              << " global_unique_words=" << global_counts_.size()
+              << " window_unique_words=" << window_counts_.size()
+              << " window_start_index=" << window_start_index_
+              << " latest_bucket_ms=" << (history_buckets_.empty() ? -1LL : history_buckets_.back().bucket_start_time);
 }
 
 /*
@@ -418,7 +908,7 @@ std::vector<TrendItem> Analyzer::GetTrending(int k, int min_threshold) {
     }
 
     // 5. 排序：按斜率绝对值从大到小 (同时飙升和骤降)
-    if (k > (int)result.size()) k = result.size();
+    k = std::max(0, std::min(k, (int)result.size()));
     
     std::partial_sort(result.begin(), result.begin() + k, result.end(),
         [](const TrendItem& a, const TrendItem& b) {
@@ -1,55 +1,23 @@
 #include "crow.h"
 #include "Analyzer.h"
 #include "AsyncProcessor.h"
+#include "ChannelRegistry.h"
+#include "TopKStream.h"
+#include "ResponseCache.h"
+#include "JsonWriter.h"
+#include "BinaryWriter.h"
+#include "StaticAssets.h"
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <string>
 #include <filesystem>
 #include <chrono>
-
-// ==========================================
-// 辅助函数：MIME 类型判断
-// ==========================================
-std::string GetMimeType(const std::string& path) {
-    if (path.ends_with(".html")) return "text/html";
-    if (path.ends_with(".js"))   return "application/javascript";
-    if (path.ends_with(".css"))  return "text/css";
-    if (path.ends_with(".png"))  return "image/png";
-    if (path.ends_with(".jpg") || path.ends_with(".jpeg")) return "image/jpeg";
-    if (path.ends_with(".svg"))  return "image/svg+xml";
-    if (path.ends_with(".ico"))  return "image/x-icon";
-    if (path.ends_with(".json")) return "application/json";
-    if (path.ends_with(".woff2")) return "font/woff2";
-    if (path.ends_with(".woff"))  return "font/woff";
-    if (path.ends_with(".ttf"))   return "font/ttf";
-    return "application/octet-stream";
-}
-
-// ==========================================
-// 辅助函数：读取并发送静态文件
-// ==========================================
-crow::response ServeStaticFile(const std::string& filepath) {
-    // 必须以二进制模式打开，否则图片/字体会损坏
-    std::ifstream ifs(filepath, std::ios::binary);
-    if (!ifs.is_open()) {
-        // --- 调试日志 ---
-        std::cerr << "[Error] Failed to open file: " << filepath 
-                  << " | Reason: " << std::strerror(errno) << std::endl;
-        // ------------------
-        return crow::response(404);
-    }
-    std::ostringstream oss;
-    oss << ifs.rdbuf();
-
-    crow::response resp(200, oss.str());
-    resp.set_header("Content-Type", GetMimeType(filepath));
-    return resp;
-}
+#include <cstdlib>
 
 int main(int argc, char* argv[]) {
     // 1. 初始化核心业务逻辑
-    std::cout << "[Init] Loading dictionaries..." << std::endl;
+    LOG(INFO) << "[Init] Loading dictionaries...";
     Analyzer analyzer("../include/dict/jieba.dict.utf8", 
         "../include/dict/hmm_model.utf8", 
         "../include/dict/user.dict.utf8", 
@@ -58,6 +26,14 @@ int main(int argc, char* argv[]) {
     
     int batch_size = 10;
     int num_threads = 8;
+    std::size_t cache_capacity = 1 << 16;
+    IdfSource idf_source = IdfSource::Static;
+    std::size_t parallel_threshold = 16 * 1024;
+    std::vector<std::string> pos_classes;
+    bool multi_granularity = false;
+    std::string windows = "1m,5m,1h,24h";
+    std::string data_dir = "./data";
+    long long hot_duration_ms = 24LL * 3600 * 1000;
     try {
         if (argc >= 2) {
             // ./app [batch_size]
@@ -68,68 +44,293 @@ int main(int argc, char* argv[]) {
             // ./app [batch_size] [num_threads]
             num_threads = std::stoi(argv[2]);
         }
+
+        if (argc >= 4) {
+            // ./app [batch_size] [num_threads] [cache_capacity]，0 表示关闭分词缓存
+            cache_capacity = std::stoul(argv[3]);
+        }
+
+        if (argc >= 5) {
+            // ./app [batch_size] [num_threads] [cache_capacity] [static|background]，TF-IDF 的 IDF 来源
+            std::string source = argv[4];
+            if (source == "background") idf_source = IdfSource::Background;
+            else if (source != "static") throw std::invalid_argument("idf source must be static or background");
+        }
+
+        if (argc >= 6) {
+            // ./app ... [parallel_threshold]，超过这个字节数的单行拆段并行分词，0 表示不拆
+            parallel_threshold = std::stoul(argv[5]);
+        }
+
+        if (argc >= 7) {
+            // ./app ... [pos_classes]，逗号分隔，如 n,nr,ns,nt,nz,eng：只统计这些词性（jieba 词典里机构名是 nt）
+            // "-" 表示不按词性过滤
+            std::stringstream ss(std::string(argv[6]) == "-" ? "" : argv[6]);
+            std::string tag;
+            while (std::getline(ss, tag, ',')) {
+                if (!tag.empty()) pos_classes.push_back(tag);
+            }
+        }
+
+        if (argc >= 8) {
+            // ./app ... [coarse|multi]，multi 时长词和它里面的词典词都计数
+            std::string granularity = argv[7];
+            if (granularity == "multi") multi_granularity = true;
+            else if (granularity != "coarse") throw std::invalid_argument("granularity must be coarse or multi");
+        }
+
+        if (argc >= 9) {
+            // ./app ... [mix|mp|whitespace|bigram]，分词后端；后两种是压测聚合层用的假分词
+            TokenizerKind tokenizer_kind;
+            if (!ParseTokenizerKind(argv[8], tokenizer_kind)) {
+                throw std::invalid_argument("tokenizer must be mix, mp, whitespace or bigram");
+            }
+            analyzer.SetTokenizer(tokenizer_kind);
+        }
+
+        if (argc >= 10) {
+            // ./app ... [windows]，逗号分隔的额外滑动窗口，如 1m,5m,1h,24h（10m 总是有）；"-" 表示不要额外窗口
+            windows = std::string(argv[9]) == "-" ? "" : argv[9];
+        }
+        if (argc >= 11) {
+            // ./app ... [data_dir]，统计数据的日志和快照目录，重启时从这里恢复；"-" 表示不持久化
+            data_dir = std::string(argv[10]) == "-" ? "" : argv[10];
+        }
+        if (argc >= 12) {
+            // ./app ... [hot]，内存里保留多久的时间桶（不短于最长的窗口），更早的写进 data_dir/cold 的段文件；
+            // "-" 表示全放内存
+            std::string hot = argv[11];
+            hot_duration_ms = hot == "-" ? -1 : ParseWindowDuration(hot);
+            if (hot != "-" && hot_duration_ms < 0) throw std::invalid_argument("hot duration must look like 30m, 6h or 1d");
+        }
+
+        std::stringstream ss(windows);
+        std::string name;
+        while (std::getline(ss, name, ',')) {
+            if (name.empty() || name == "10m") continue;
+            long long duration_ms = ParseWindowDuration(name);
+            if (duration_ms < 0) throw std::invalid_argument("window must look like 30s, 5m, 1h or 1d");
+            analyzer.AddWindow(name, duration_ms);
+        }
     } catch (const std::exception& e) {
-        std::cerr << "Parameters format error, pls use integer. Error msg: " << e.what() << std::endl;
+        LOG(ERROR) << "Parameters format error, pls use integer. Error msg: " << e.what();
         return 1;
     }
     
-    AsyncProcessor processor(analyzer, batch_size);
+    analyzer.SetIdfSource(idf_source);
+    analyzer.SetPosClasses(pos_classes);
+    analyzer.SetMultiGranularity(multi_granularity);
+    AsyncProcessor processor(analyzer, batch_size, cache_capacity, parallel_threshold);
+
+    // 持久化：先从日志和快照恢复（不重新分词），再开始接收数据；提交线程每 100ms 批量写盘一次
+    WriteAheadLog wal(data_dir);
+    ChannelRegistry channels(analyzer); // 按直播间分开统计，analyzer 同时是跨频道的全局视图
+    WalCommitter committer;
+    if (!data_dir.empty()) {
+        if (hot_duration_ms >= 0) analyzer.EnableColdArchive(data_dir + "/cold", hot_duration_ms);
+        if (!wal.Recover(analyzer) || !channels.EnablePersistence(data_dir + "/channels", &committer)) {
+            return 1;
+        }
+        analyzer.AttachWal(&wal);
+        committer.Add(&wal, &analyzer);
+        committer.Start();
+    }
+    WordMiner miner(analyzer); // 新词发现，发现的新词会热更新进词典
+    processor.AttachMiner(&miner);
     processor.Start(num_threads); // 启动8个处理线程
+    miner.Start();
+    TopKStream stream(analyzer); // 看板推送：每秒算一次 TopK 和趋势，广播给所有订阅者
+    stream.Start();
 
     // 2. 初始化 Web 服务器
     crow::SimpleApp app;
 
+    // 管理接口（改词典）的口令：从环境变量 HOTWORDS_ADMIN_TOKEN 读，不放命令行参数（ps 能看到）；
+    // 请求带 Authorization: Bearer <口令>。没设置时管理接口一律 403，看板和写入端口对外开放也改不了词典
+    const char* admin_token_env = std::getenv("HOTWORDS_ADMIN_TOKEN");
+    const std::string admin_token = admin_token_env != nullptr ? admin_token_env : "";
+    if (admin_token.empty()) LOG(WARN) << "[Init] HOTWORDS_ADMIN_TOKEN is not set, /api/admin/* is disabled";
+    auto IsAdmin = [&admin_token](const crow::request& req) {
+        if (admin_token.empty()) return false;
+        std::string expected = "Bearer " + admin_token;
+        const std::string& given = req.get_header_value("Authorization");
+        if (given.size() != expected.size()) return false;
+        unsigned char diff = 0; // 逐字节比完，耗时不随第一个不同字节的位置变化
+        for (std::size_t i = 0; i < given.size(); ++i) diff |= (unsigned char)(given[i] ^ expected[i]);
+        return diff == 0;
+    };
+
     // 定义静态文件根目录 (相对于 exe 文件)
     const std::string STATIC_ROOT = "./static"; 
+    // 启动时整个读进内存并预压缩，之后请求不再读盘；目录有变化时自动重新加载
+    StaticAssets static_assets(STATIC_ROOT);
+    static_assets.Watch();
 
     // ============================================================
-    // Lambda: 统一序列化 TopK 结果为 JSON
+    // Lambda: 统一序列化 TopK 结果（w 是 JsonWriter 或 BinaryWriter）
     // ============================================================
-    auto SerializeTopK = [](const std::vector<std::pair<std::string, int>>& result) {
-        crow::json::wvalue json_resp;
-        json_resp["data"] = crow::json::wvalue::list();
+    auto SerializeTopK = [](auto& w, const std::vector<std::pair<std::string, int>>& result) {
+        w.BeginObject().Key("data").BeginArray();
         for (size_t i = 0; i < result.size(); ++i) {
-            crow::json::wvalue item;
-            item["word"] = result[i].first;
-            item["count"] = result[i].second;
-            json_resp["data"][i] = std::move(item);
+            w.BeginObject().Key("word").String(result[i].first).Key("count").Int(result[i].second).EndObject();
+        }
+        w.EndArray().Key("status").String("success").EndObject();
+    };
+
+    // ============================================================
+    // 响应格式：默认 JSON，format=binary 或 Accept 里有二进制类型时用 BinaryWriter.h 的紧凑格式；
+    // 每个接口的 build 只写一遍，两种 writer 接口相同
+    // ============================================================
+    auto RequestedFormat = [](const crow::request& req) {
+        const char* format = req.url_params.get("format");
+        if (format != nullptr) return std::string(format) == "binary" ? ResponseFormat::Binary : ResponseFormat::Json;
+        if (req.get_header_value("Accept").find(BinaryContentType()) != std::string::npos) return ResponseFormat::Binary;
+        return ResponseFormat::Json;
+    };
+
+    // 响应体写在本线程复用的缓冲区里（不建 wvalue 树），写完拷进响应
+    auto WriteBody = [](ResponseFormat format, const auto& build) -> const std::string& {
+        thread_local std::string buffer;
+        buffer.clear();
+        if (format == ResponseFormat::Binary) {
+            BinaryWriter w(buffer);
+            build(w);
+        } else {
+            JsonWriter w(buffer);
+            build(w);
+        }
+        return buffer;
+    };
+    auto SetContentType = [](crow::response& resp, ResponseFormat format) {
+        resp.set_header("Content-Type", format == ResponseFormat::Binary ? BinaryContentType() : "application/json");
+        resp.set_header("Vary", "Accept");
+    };
+    auto QueryResponse = [&RequestedFormat, &WriteBody, &SetContentType](const crow::request& req, const auto& build) {
+        ResponseFormat format = RequestedFormat(req);
+        crow::response resp(200, WriteBody(format, build));
+        SetContentType(resp, format);
+        return resp;
+    };
+
+    // ============================================================
+    // 读接口的响应缓存：key 是接口+规整后的参数+格式，数据版本不变就直接返回上次序列化好的响应体；
+    // 客户端带的 If-None-Match 和当前 ETag 一致时回 304，连响应体都不用发
+    // ============================================================
+    ResponseCache response_cache;
+    auto CachedResponse = [&response_cache, &RequestedFormat, &WriteBody, &SetContentType](
+                              const crow::request& req, Analyzer& target, std::string key, const auto& build) {
+        ResponseFormat format = RequestedFormat(req);
+        if (format == ResponseFormat::Binary) key += "|bin";
+        if (req.url_params.get("channel") != nullptr) key = std::string(req.url_params.get("channel")) + "|" + key;
+        uint64_t version = target.GetDataVersion();
+        std::string etag = ResponseCache::MakeETag(key, version);
+        if (ResponseCache::ETagMatches(req.get_header_value("If-None-Match"), etag)) {
+            crow::response resp(304);
+            resp.set_header("ETag", etag);
+            return resp;
         }
-        json_resp["status"] = "success";
-        return json_resp;
+        std::shared_ptr<const std::string> body = response_cache.Get(key, version);
+        if (!body) body = response_cache.Put(key, version, WriteBody(format, build));
+
+        crow::response resp(200, *body);
+        SetContentType(resp, format);
+        resp.set_header("ETag", etag);
+        resp.set_header("Cache-Control", "no-cache"); // 可以缓存，但每次都要带 ETag 来确认
+        return resp;
+    };
+
+    // ============================================================
+    // 查询的对象：带 channel=房间号 时是这个频道，不带时是跨频道的全局视图；频道不存在时为空（回 404）
+    // ============================================================
+    auto QueryTarget = [&channels](const crow::request& req) -> Analyzer* {
+        const char* name = req.url_params.get("channel");
+        if (name == nullptr) return &channels.Global();
+        return channels.Find(name);
     };
 
     // ============================================================
     // API 路由定义 (必须在 Catch-All 之前定义)
     // ============================================================
 
-    // API 1: 数据输入
+    // API 1: 数据输入，channel=房间号 时同时计入这个频道（第一次出现时创建）
     CROW_ROUTE(app, "/api/ingest").methods(crow::HTTPMethod::POST)
-    ([&processor](const crow::request& req){
+    ([&processor, &channels](const crow::request& req){
         std::string line = req.body;
         if (line.empty()) return crow::response(400);
-        processor.PushTask(line);
+        Analyzer* channel = nullptr;
+        if (req.url_params.get("channel") != nullptr) {
+            channel = channels.GetOrCreate(req.url_params.get("channel"));
+            if (channel == nullptr) return crow::response(400, "invalid channel name or too many channels");
+        }
+        processor.PushTask(line, channel);
         return crow::response(200, "OK");
     });
 
-    // API 2: 实时 TopK (最近10分钟)
+    // API 2: 实时 TopK (最近10分钟)，rank=tfidf 时按 TF-IDF 排名（压低"哈哈""什么"这类通用高频词）
+    //        pos=nr 时只看某个词性（人名 nr、地名 ns、机构名 nt ...）
+    //        window=5m 时看启动时注册的其它窗口（按词频），没注册的窗口回 400
+    //        channel=房间号 时只看这个频道（下面的查询接口都一样）
     CROW_ROUTE(app, "/api/topk")
-    ([&analyzer, &SerializeTopK](const crow::request& req){
+    ([&QueryTarget, &SerializeTopK, &CachedResponse](const crow::request& req){
+        Analyzer* target = QueryTarget(req);
+        if (target == nullptr) return crow::response(404, "unknown channel");
+        Analyzer& analyzer = *target;
         int k = 10;
         if (req.url_params.get("k") != nullptr) k = std::stoi(req.url_params.get("k"));
-        return SerializeTopK(analyzer.GetLast10MinTopK(k));
+        const char* window = req.url_params.get("window");
+        if (window != nullptr && std::string(window) != "10m") {
+            std::string name = window;
+            if (!analyzer.HasWindow(name)) return crow::response(400, "unknown window");
+            return CachedResponse(req, analyzer, "topk|window|" + name + "|" + std::to_string(k), [&](auto& w) {
+                SerializeTopK(w, analyzer.GetWindowTopK(name, k));
+            });
+        }
+        if (req.url_params.get("pos") != nullptr) {
+            std::string pos = req.url_params.get("pos");
+            return CachedResponse(req, analyzer, "topk|pos|" + pos + "|" + std::to_string(k), [&](auto& w) {
+                SerializeTopK(w, analyzer.GetLast10MinTopKByPos(pos, k));
+            });
+        }
+        const char* rank = req.url_params.get("rank");
+        if (rank == nullptr || std::string(rank) != "tfidf") {
+            return CachedResponse(req, analyzer, "topk|count|" + std::to_string(k), [&](auto& w) {
+                SerializeTopK(w, analyzer.GetLast10MinTopK(k));
+            });
+        }
+
+        return CachedResponse(req, analyzer, "topk|tfidf|" + std::to_string(k), [&](auto& w) {
+            std::vector<KeywordItem> keywords = analyzer.GetLast10MinKeywords(k);
+            w.BeginObject().Key("data").BeginArray();
+            for (size_t i = 0; i < keywords.size(); ++i) {
+                w.BeginObject()
+                    .Key("word").String(keywords[i].word)
+                    .Key("count").Int(keywords[i].count)
+                    .Key("score").Double(keywords[i].score)
+                    .EndObject();
+            }
+            w.EndArray().Key("status").String("success").EndObject();
+        });
     });
 
     // API 3: 全量历史 TopK
     CROW_ROUTE(app, "/api/history")
-    ([&analyzer, &SerializeTopK](const crow::request& req){
+    ([&QueryTarget, &SerializeTopK, &CachedResponse](const crow::request& req){
+        Analyzer* target = QueryTarget(req);
+        if (target == nullptr) return crow::response(404, "unknown channel");
+        Analyzer& analyzer = *target;
         int k = 20;
         if (req.url_params.get("k") != nullptr) k = std::stoi(req.url_params.get("k"));
-        return SerializeTopK(analyzer.GetTopK(k));
+        return CachedResponse(req, analyzer, "history|" + std::to_string(k), [&](auto& w) {
+            SerializeTopK(w, analyzer.GetTopK(k));
+        });
     });
 
     // API 4: 自定义时间段查询
     CROW_ROUTE(app, "/api/range")
-    ([&analyzer, &SerializeTopK](const crow::request& req){
+    ([&QueryTarget, &SerializeTopK, &QueryResponse](const crow::request& req){
+        Analyzer* target = QueryTarget(req);
+        if (target == nullptr) return crow::response(404, "unknown channel");
+        Analyzer& analyzer = *target;
         long long start_ts = 0;
         long long end_ts = 0;
         int k = 10;
@@ -141,45 +342,191 @@ int main(int argc, char* argv[]) {
             end_ts = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::system_clock::now().time_since_epoch()).count();
         }
-        return SerializeTopK(analyzer.GetTopKInTimeRange(start_ts, end_ts, k));
+        return QueryResponse(req, [&](auto& w) {
+            SerializeTopK(w, analyzer.GetTopKInTimeRange(start_ts, end_ts, k));
+        });
     });
 
     // API 5: 趋势分析 (Trending)
     CROW_ROUTE(app, "/api/trending")
-    ([&analyzer](const crow::request& req){
+    ([&QueryTarget, &CachedResponse](const crow::request& req){
+        Analyzer* target = QueryTarget(req);
+        if (target == nullptr) return crow::response(404, "unknown channel");
+        Analyzer& analyzer = *target;
         int k = 3; 
         if (req.url_params.get("k") != nullptr) k = std::stoi(req.url_params.get("k"));
         int threshold = 5; 
         if (req.url_params.get("threshold") != nullptr) threshold = std::stoi(req.url_params.get("threshold"));
 
-        std::vector<TrendItem> trends = analyzer.GetTrending(k, threshold);
-
-        crow::json::wvalue json_resp;
-        json_resp["data"] = crow::json::wvalue::list();
-        for (size_t i = 0; i < trends.size(); ++i) {
-            crow::json::wvalue item;
-            item["word"] = trends[i].word;
-            item["slope"] = trends[i].slope;
-            item["count"] = trends[i].total_count;
-            
-            if (trends[i].slope > 1.0) item["tag"] = "rising"; 
-            else if (trends[i].slope < -1.0) item["tag"] = "falling";
-            else item["tag"] = "stable";
-
-            json_resp["data"][i] = std::move(item);
-        }
-        json_resp["status"] = "success";
-        json_resp["timestamp"] = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
+        // timestamp 是这份结果的计算时间（缓存命中时不会变）
+        return CachedResponse(req, analyzer, "trending|" + std::to_string(k) + "|" + std::to_string(threshold), [&](auto& w) {
+            std::vector<TrendItem> trends = analyzer.GetTrending(k, threshold);
+
+            w.BeginObject().Key("data").BeginArray();
+            for (size_t i = 0; i < trends.size(); ++i) {
+                w.BeginObject()
+                    .Key("word").String(trends[i].word)
+                    .Key("slope").Double(trends[i].slope)
+                    .Key("count").Int(trends[i].total_count)
+                    .Key("tag").String(TrendTag(trends[i].slope))
+                    .EndObject();
+            }
+            w.EndArray().Key("status").String("success");
+            w.Key("timestamp").Int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+            w.EndObject();
+        });
+    });
+
+    // API 5.1: 当前话题 (窗口共现图上的 PageRank)
+    CROW_ROUTE(app, "/api/topics")
+    ([&QueryTarget, &CachedResponse](const crow::request& req){
+        Analyzer* target = QueryTarget(req);
+        if (target == nullptr) return crow::response(404, "unknown channel");
+        Analyzer& analyzer = *target;
+        int k = 10;
+        if (req.url_params.get("k") != nullptr) k = std::stoi(req.url_params.get("k"));
 
-        return json_resp;
+        return CachedResponse(req, analyzer, "topics|" + std::to_string(k), [&](auto& w) {
+            std::vector<std::pair<std::string, double>> topics = analyzer.GetTopTopics(k);
+            w.BeginObject().Key("data").BeginArray();
+            for (size_t i = 0; i < topics.size(); ++i) {
+                w.BeginObject().Key("word").String(topics[i].first).Key("rank").Double(topics[i].second).EndObject();
+            }
+            w.EndArray().Key("status").String("success").EndObject();
+        });
     });
 
+    // API 5.2: 已有的频道
+    CROW_ROUTE(app, "/api/channels")
+    ([&channels, &QueryResponse](const crow::request& req){
+        std::vector<std::string> names = channels.Names();
+        return QueryResponse(req, [&](auto& w) {
+            w.BeginObject().Key("data").BeginArray();
+            for (size_t i = 0; i < names.size(); ++i) {
+                w.String(names[i]);
+            }
+            w.EndArray().Key("status").String("success").EndObject();
+        });
+    });
+
+    // API 6: 运行状态 (分词缓存命中率等)
+    CROW_ROUTE(app, "/api/stats")
+    ([&processor, &analyzer, &channels, &wal, &response_cache, &QueryResponse](const crow::request& req){
+        SegmentCache::Stats stats = processor.GetCacheStats();
+        return QueryResponse(req, [&](auto& w) {
+            w.BeginObject().Key("data").BeginObject();
+            w.Key("cache").BeginObject()
+                .Key("hits").UInt(stats.hits)
+                .Key("misses").UInt(stats.misses)
+                .Key("hit_rate").Double(stats.hit_rate)
+                .Key("insertions").UInt(stats.insertions)
+                .Key("evictions").UInt(stats.evictions)
+                .Key("size").UInt(stats.size)
+                .Key("capacity").UInt(stats.capacity)
+                .EndObject();
+            w.Key("dict_version").UInt(analyzer.AcquireDict()->version);
+            w.Key("tokenizer").String(analyzer.GetTokenizerName());
+            w.Key("data_version").UInt(analyzer.GetDataVersion());
+            w.Key("channels").UInt(channels.Size());
+            w.Key("wal_synced_bytes").UInt(wal.GetSyncedBytes());
+            w.Key("wal_snapshot_segment").UInt(wal.GetSnapshotSegment());
+            std::size_t cold_segments = 0, cold_buckets = 0, cold_bytes = 0;
+            if (analyzer.GetColdStats(cold_segments, cold_buckets, cold_bytes)) {
+                w.Key("cold").BeginObject()
+                    .Key("segments").UInt(cold_segments)
+                    .Key("buckets").UInt(cold_buckets)
+                    .Key("bytes").UInt(cold_bytes)
+                    .EndObject();
+            }
+            w.Key("response_cache_entries").UInt(response_cache.Size());
+            w.EndObject().Key("status").String("success").EndObject();
+        });
+    });
+
+    // API 7: 新词发现结果
+    CROW_ROUTE(app, "/api/newwords")
+    ([&miner, &QueryResponse](const crow::request& req){
+        int k = 20;
+        if (req.url_params.get("k") != nullptr) k = std::stoi(req.url_params.get("k"));
+
+        std::vector<NewWordCandidate> candidates = miner.GetCandidates(k);
+        std::vector<std::string> promoted = miner.GetPromoted();
+        return QueryResponse(req, [&](auto& w) {
+            w.BeginObject().Key("data").BeginObject();
+            w.Key("candidates").BeginArray();
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                w.BeginObject()
+                    .Key("word").String(candidates[i].word)
+                    .Key("count").Int(candidates[i].count)
+                    .Key("cohesion").Double(candidates[i].cohesion)
+                    .Key("left_entropy").Double(candidates[i].left_entropy)
+                    .Key("right_entropy").Double(candidates[i].right_entropy)
+                    .EndObject();
+            }
+            w.EndArray();
+            w.Key("promoted").BeginArray();
+            for (size_t i = 0; i < promoted.size(); ++i) {
+                w.String(promoted[i]);
+            }
+            w.EndArray();
+            w.Key("dropped_lines").UInt(miner.GetDroppedLines());
+            w.EndObject().Key("status").String("success").EndObject();
+        });
+    });
+
+    // API 8: 词典热更新（要管理口令，见 IsAdmin；每次都要复制整棵 trie，不能对外开放）
+    // body 每行一条: "+词 [词性]" 新增, "-词" 删除；新词典构建完成后原子替换，不影响正在进行的分词。
+    // 改动只在内存里：不写日志也不进快照，重启后日志回放的是词频，词典回到启动时的词典文件
+    CROW_ROUTE(app, "/api/admin/dict").methods(crow::HTTPMethod::POST)
+    ([&analyzer, &QueryResponse, &IsAdmin](const crow::request& req){
+        if (!IsAdmin(req)) return crow::response(403);
+        if (req.body.size() > 1024 * 1024) return crow::response(413);
+        std::vector<std::pair<std::string, std::string>> inserts;
+        std::vector<std::string> deletes;
+        std::istringstream body(req.body);
+        std::string line;
+        while (std::getline(body, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.size() < 2) continue;
+            std::istringstream fields(line.substr(1));
+            std::string word, tag;
+            fields >> word >> tag;
+            if (word.empty()) continue;
+            if (line[0] == '+') inserts.emplace_back(word, tag);
+            else if (line[0] == '-') deletes.push_back(word);
+            else return crow::response(400, "each line must start with '+' or '-'");
+        }
+        if (inserts.empty() && deletes.empty()) return crow::response(400);
+
+        uint64_t version = analyzer.UpdateDictionary(inserts, deletes);
+        return QueryResponse(req, [&](auto& w) {
+            w.BeginObject().Key("data").BeginObject()
+                .Key("version").UInt(version)
+                .Key("inserted").UInt(inserts.size())
+                .Key("deleted").UInt(deletes.size())
+                .EndObject();
+            w.Key("status").String("success").EndObject();
+        });
+    });
+
+    // API 9: 看板推送 (WebSocket)，连上先收到完整快照，之后每秒只收变化的部分
+    CROW_WEBSOCKET_ROUTE(app, "/api/stream")
+        .onopen([&stream](crow::websocket::connection& conn) {
+            stream.Subscribe(&conn, [&conn](const std::string& msg) { conn.send_text(msg); });
+        })
+        .onclose([&stream](crow::websocket::connection& conn, auto&&...) {
+            stream.Unsubscribe(&conn);
+        })
+        .onmessage([](crow::websocket::connection&, const std::string&, bool) {
+            // 单向推送，忽略客户端消息
+        });
+
     // ============================================================
     // 静态资源路由 (Catch-All)
     // ============================================================
     CROW_CATCHALL_ROUTE(app)
-    ([STATIC_ROOT](const crow::request& req){
+    ([&static_assets](const crow::request& req){
         std::string path = req.url;
         
         // 去掉 URL 参数（如果有 ?k=v 这种）
@@ -190,53 +537,66 @@ int main(int argc, char* argv[]) {
 
         // 1. 默认首页
         if (path == "/" || path == "") {
-            return ServeStaticFile(STATIC_ROOT + "/index.html");
+            path = "/index.html";
         }
 
-        // 2. 构造物理路径
-        std::string file_path = STATIC_ROOT + path;
-
-        // --- 调试日志：打印到底在找哪个文件，以及当前工作目录在哪里 ---
-        std::cout << "[Debug] Request: " << path << " -> Looking at: " << std::filesystem::absolute(file_path) << std::endl;
+        // 2. 只查内存里的表，不碰磁盘；快照在响应构造完之前一直持有
+        std::shared_ptr<const StaticAssets::AssetMap> assets = static_assets.Snapshot();
+        StaticAssets::Selected selected = StaticAssets::Select(*assets, path, req.get_header_value("Accept-Encoding"));
 
-        // 安全检查
-        if (path.find("..") != std::string::npos) return crow::response(403);
-
-        // 3. 尝试查找物理文件
-        if (std::filesystem::exists(file_path) && std::filesystem::is_regular_file(file_path)) {
-            std::cout << "[Debug] File exists, trying to serve..." << std::endl;
-            return ServeStaticFile(file_path);
-        }
-
-        // 4. SPA Fallback
+        // 3. SPA Fallback
         // 如果请求的是静态资源（assets, js, css, png...），找不到就是真的 404，不要返回 index.html
         // Vue/Vite 打包默认会把资源放在 assets 目录下，或者通过后缀判断
-        bool is_static_asset = false;
-        if (path.starts_with("/assets/") || 
-            path.ends_with(".js") || 
-            path.ends_with(".css") || 
-            path.ends_with(".png") || 
-            path.ends_with(".ico")) {
-            is_static_asset = true;
+        if (selected.asset == nullptr) {
+            bool is_static_asset = false;
+            if (path.starts_with("/assets/") || 
+                path.ends_with(".js") || 
+                path.ends_with(".css") || 
+                path.ends_with(".png") || 
+                path.ends_with(".ico")) {
+                is_static_asset = true;
+            }
+            if (is_static_asset) {
+                return crow::response(404); // 明确告知浏览器文件不存在
+            }
+            // 只有非资源的路径（比如 /user/login 这种页面路由）才返回 index.html
+            selected = StaticAssets::Select(*assets, "/index.html", req.get_header_value("Accept-Encoding"));
+            if (selected.asset == nullptr) return crow::response(404);
         }
 
-        if (is_static_asset) {
-            std::cout << "[404] Missing asset: " << file_path << std::endl;
-            return crow::response(404); // 明确告知浏览器文件不存在
+        const StaticAsset& asset = *selected.asset;
+        if (ResponseCache::ETagMatches(req.get_header_value("If-None-Match"), *selected.etag)) {
+            crow::response resp(304);
+            resp.set_header("Vary", "Accept-Encoding");
+            resp.set_header("ETag", *selected.etag);
+            resp.set_header("Cache-Control", asset.cache_control);
+            return resp;
         }
-
-        // 只有非资源的路径（比如 /user/login 这种页面路由）才返回 index.html
-        return ServeStaticFile(STATIC_ROOT + "/index.html");
+        crow::response resp(200, *selected.body);
+        resp.set_header("Content-Type", asset.content_type);
+        if (selected.encoding != nullptr) resp.set_header("Content-Encoding", selected.encoding);
+        resp.set_header("Vary", "Accept-Encoding");
+        resp.set_header("ETag", *selected.etag);
+        resp.set_header("Cache-Control", asset.cache_control);
+        return resp;
     });
 
     // 3. 启动服务器
-    std::cout << "[Init] Server starting at http://localhost:18080" << std::endl;
-    std::cout << "[Init] Serving static files from: " << std::filesystem::absolute(STATIC_ROOT) << std::endl;
+    LOG(INFO) << "[Init] Server starting at http://localhost:18080";
+    LOG(INFO) << "[Init] Serving static files from: " << std::filesystem::absolute(STATIC_ROOT)
+              << " (" << static_assets.Snapshot()->size() << " files, "
+              << StaticAssets::MemoryBytes(*static_assets.Snapshot()) / 1024 << " KB in memory)";
     
+    // crow 自己在 INFO 级别每个请求打一行（同步写 clog），只留警告以上
+    app.loglevel(crow::LogLevel::Warning);
     app.port(18080).multithreaded().run();
 
     // 4. 退出清理
+    static_assets.StopWatching();
+    stream.Stop();
     processor.StopAndWait();
+    miner.Stop();
+    committer.Stop(); // 最后一次写盘并做快照
     return 0;
 }
 
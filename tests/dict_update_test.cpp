@@ -0,0 +1,68 @@
+/*
+    词典热更新之后再写入：worker 用新版本切出的 DictUnit 必须按新版本的词池转回字符串
+    （删词会让词池里的偏移整体移动，新词的偏移超出初始版本的词池）
+    用临时目录里的小词典，不依赖完整的 jieba 词典
+*/
+#include "AsyncProcessor.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unistd.h>
+
+static void WriteFile(const std::string& path, const std::string& content) {
+    std::ofstream(path) << content;
+}
+
+int main() {
+    std::string dir = std::filesystem::temp_directory_path().string() + "/dict_update_test." + std::to_string(getpid());
+    std::filesystem::create_directories(dir);
+    WriteFile(dir + "/jieba.dict.utf8", "中华 300 nz\n人民 200 n\n共和国 150 n\n万岁 80 v\n");
+    WriteFile(dir + "/user.dict.utf8", "");
+    WriteFile(dir + "/idf.utf8", "人民 5.0\n万岁 6.0\n");
+    WriteFile(dir + "/stop_words.utf8", "的\n");
+
+    int failures = 0;
+    {
+        Analyzer analyzer(dir + "/jieba.dict.utf8", HOTWORDS_DICT_DIR "/hmm_model.utf8", dir + "/user.dict.utf8",
+                          dir + "/idf.utf8", dir + "/stop_words.utf8");
+        // 删掉排在最前面的词，之后每个词在词池里的偏移都和初始版本不同
+        analyzer.UpdateDictionary({{"热词", "n"}}, {"中华"});
+
+        const int lines = 200;
+        AsyncProcessor processor(analyzer, 7, 0, 0);
+        processor.Start(3);
+        for (int i = 0; i < lines; ++i) {
+            processor.PushTask("[0:00:" + std::to_string(10 + i % 40) + "]人民热词万岁");
+        }
+        processor.StopAndWait();
+
+        std::map<std::string, int> expected = {{"人民", lines}, {"热词", lines}, {"万岁", lines}};
+        std::map<std::string, int> actual;
+        for (const auto& kv : analyzer.GetTopK(100)) actual[kv.first] = kv.second;
+        if (actual != expected) {
+            std::cerr << "unexpected counts after dictionary update:";
+            for (const auto& kv : actual) std::cerr << " " << kv.first << "=" << kv.second;
+            std::cerr << std::endl;
+            ++failures;
+        }
+    }
+
+    {
+        // 单个词的删除只摘掉 trie 节点，之后再重建词典时不能把它带回来
+        cppjieba::Jieba jieba(dir + "/jieba.dict.utf8", HOTWORDS_DICT_DIR "/hmm_model.utf8", dir + "/user.dict.utf8",
+                              dir + "/idf.utf8", dir + "/stop_words.utf8");
+        jieba.DeleteUserWord("人民");
+        jieba.InsertUserWord("万岁", "v");
+        jieba.UpdateDictionary({{"热词", "n"}}, {});
+        jieba.InsertUserWord("热词2", "n");
+        if (jieba.Find("人民") || !jieba.Find("万岁") || !jieba.Find("热词") || !jieba.Find("热词2")) {
+            std::cerr << "dictionary rebuild lost a delete or an insert" << std::endl;
+            ++failures;
+        }
+    }
+
+    std::filesystem::remove_all(dir);
+    if (failures == 0) std::cout << "dict_update_test passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
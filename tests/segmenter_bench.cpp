@@ -0,0 +1,287 @@
+/*
+    Segmenter（编译期固定配置）和原来按运行时开关走的 MixSegment 分词流水线对比：
+    同一份语料、同一个词典版本，逐个 token 比较（DictUnit、字节区间、词性、是否子词），再各跑几轮取最快的一次计时。
+
+    用法：segmenter_bench [词典目录] [语料文件] [轮数]
+    - 词典目录默认是 include/dict；里面没有 jieba.dict.utf8（完整词典不在仓库里）时，
+      写一个临时的小词典，只校验结果一致，计时没有参考价值
+    - 语料文件每行一条弹幕；不给时按固定种子生成一批混合中文、数字、英文、标点、表情的行
+    结果不一致时返回 1
+*/
+#include "cppjieba/Jieba.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <unistd.h>
+
+using namespace cppjieba;
+
+/*
+    Segmenter 之前的 MixSegment::CutBatch + Jieba::RemoveStopWords，原样保留作对照：
+    hmm、sub_words 每个词段、每个词都要判断一次，去停用词是分完词以后再过一遍
+*/
+class RuntimeSegment {
+private:
+    const MPSegment& mp_seg_;
+    const HMMSegment& hmm_seg_;
+    const SymbolSet& symbols_;
+    const DictTrie* dict_;
+
+    void Cut(RuneStrArray::const_iterator begin, RuneStrArray::const_iterator end, vector<WordRange>& res, bool hmm,
+             SegmentScratch& scratch) const {
+        if (!hmm) {
+            mp_seg_.Cut(begin, end, res, scratch.dags);
+            return;
+        }
+        vector<WordRange>& words = scratch.mp_words;
+        words.clear();
+        words.reserve(end - begin);
+        mp_seg_.Cut(begin, end, words, scratch.dags);
+
+        vector<WordRange>& hmm_res = scratch.hmm_words;
+        hmm_res.clear();
+        hmm_res.reserve(end - begin);
+        for (size_t i = 0; i < words.size(); i++) {
+            if (words[i].left != words[i].right || mp_seg_.IsUserDictSingleChineseWord(words[i].left->rune)) {
+                res.push_back(words[i]);
+                continue;
+            }
+            size_t j = i;
+            while (j < words.size() && words[j].left == words[j].right &&
+                   !mp_seg_.IsUserDictSingleChineseWord(words[j].left->rune)) {
+                j++;
+            }
+            hmm_seg_.Cut(words[i].left, words[j - 1].left + 1, hmm_res, scratch.viterbi);
+            for (size_t k = 0; k < hmm_res.size(); k++) {
+                res.push_back(hmm_res[k]);
+            }
+            hmm_res.clear();
+            i = j - 1;
+        }
+    }
+
+    void AppendToken(RuneStrArray::const_iterator left, RuneStrArray::const_iterator right, const DictUnit* unit,
+                     bool sub_word, vector<WordToken>& tokens) const {
+        uint32_t len = right->offset - left->offset + right->len;
+        uint8_t tag_id = (unit != NULL && unit->tag_id != 0) ? unit->tag_id
+            : dict_->SpecialTagId(PosTagger::SpecialRule(left, right + 1));
+        tokens.push_back(WordToken(unit, left->offset, len, tag_id, sub_word));
+    }
+
+    void AppendSubWords(RuneStrArray::const_iterator range_begin, const WordRange& wr, vector<WordToken>& tokens,
+                        SegmentScratch& scratch) const {
+        size_t first = wr.left - range_begin;
+        size_t length = wr.Length();
+        scratch.sub_units.clear();
+        for (size_t sub_len = 2; sub_len <= 3 && sub_len < length; sub_len++) {
+            for (size_t k = first; k + sub_len <= first + length; k++) {
+                const Dag& dag = scratch.dags[k];
+                for (size_t j = 0; j < dag.nexts.size(); j++) {
+                    const DictUnit* unit = dag.nexts[j].second;
+                    if (unit == NULL || dag.nexts[j].first != k + sub_len - 1) {
+                        continue;
+                    }
+                    if (std::find(scratch.sub_units.begin(), scratch.sub_units.end(), unit) == scratch.sub_units.end()) {
+                        scratch.sub_units.push_back(unit);
+                        AppendToken(range_begin + k, range_begin + k + sub_len - 1, unit, true, tokens);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    void AppendTokens(const string& sentence, vector<WordToken>& tokens, bool hmm, bool sub_words,
+                      SegmentScratch& scratch) const {
+        PreFilter pre_filter(symbols_, sentence, scratch.runes);
+        while (pre_filter.HasNext()) {
+            PreFilter::Range range = pre_filter.Next();
+            scratch.wrs.clear();
+            Cut(range.begin, range.end, scratch.wrs, hmm, scratch);
+            for (size_t i = 0; i < scratch.wrs.size(); i++) {
+                const WordRange& wr = scratch.wrs[i];
+                if (sub_words) {
+                    AppendSubWords(range.begin, wr, tokens, scratch);
+                }
+                const DictUnit* unit = wr.unit != NULL ? wr.unit : dict_->Find(wr.left, wr.right + 1);
+                AppendToken(wr.left, wr.right, unit, false, tokens);
+            }
+        }
+    }
+
+    void RemoveStopWords(const vector<string>& sentences, vector<WordToken>& tokens, vector<size_t>& offsets) const {
+        size_t out = 0;
+        for (size_t i = 0; i < sentences.size(); i++) {
+            size_t begin = offsets[i];
+            offsets[i] = out;
+            for (size_t j = begin; j < offsets[i + 1]; j++) {
+                if (!dict_->IsStopWord(sentences[i], tokens[j])) {
+                    tokens[out++] = tokens[j];
+                }
+            }
+        }
+        offsets[sentences.size()] = out;
+        tokens.resize(out);
+    }
+
+public:
+    RuntimeSegment(const MPSegment& mp_seg, const HMMSegment& hmm_seg, const SymbolSet& symbols)
+        : mp_seg_(mp_seg), hmm_seg_(hmm_seg), symbols_(symbols), dict_(mp_seg.GetDictTrie()) {
+    }
+
+    void CutBatch(const vector<string>& sentences, vector<WordToken>& tokens, vector<size_t>& offsets,
+                  SegmentScratch& scratch, bool hmm, bool drop_stop_words, bool sub_words) const {
+        tokens.clear();
+        offsets.clear();
+        offsets.push_back(0);
+        for (size_t i = 0; i < sentences.size(); i++) {
+            AppendTokens(sentences[i], tokens, hmm, sub_words, scratch);
+            offsets.push_back(tokens.size());
+        }
+        if (drop_stop_words) {
+            RemoveStopWords(sentences, tokens, offsets);
+        }
+    }
+};
+
+static bool SameTokens(const vector<WordToken>& a, const vector<WordToken>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].unit != b[i].unit || a[i].offset != b[i].offset || a[i].len != b[i].len ||
+            a[i].tag_id != b[i].tag_id || a[i].sub_word != b[i].sub_word) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 最快一轮的毫秒数
+static double BestMs(int rounds, const std::function<void()>& run) {
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || ms < best) best = ms;
+    }
+    return best;
+}
+
+static vector<string> MakeCorpus(size_t lines) {
+    const char* pieces[] = {
+        "主播", "今天", "好强", "哈哈哈", "666", "我们", "的", "了", "是不是", "这波", "操作", "太秀了",
+        "中华人民共和国", "万岁", "弹幕", "护体", "前方高能", "awsl", "gg", "yyds", "！", "，", "？", "。",
+        "😀", " ", "2333", "真的", "吗", "你们", "在", "说", "什么", "北京", "天安门", "南京市长江大桥",
+    };
+    const size_t count = sizeof(pieces) / sizeof(pieces[0]);
+    std::mt19937 rng(20240601);
+    vector<string> corpus;
+    corpus.reserve(lines);
+    for (size_t i = 0; i < lines; i++) {
+        string line;
+        size_t n = 2 + rng() % 14;
+        for (size_t k = 0; k < n; k++) line += pieces[rng() % count];
+        corpus.push_back(line);
+    }
+    return corpus;
+}
+
+struct Config {
+    const char* name;
+    bool hmm;
+    bool drop_stop_words;
+    bool sub_words;
+    std::function<void(const MixSegment&, const vector<string>&, vector<WordToken>&, vector<size_t>&, SegmentScratch&)> cut;
+};
+
+template <class HmmPolicy, class FilterPolicy, class OutputPolicy>
+static void CutWith(const MixSegment& mix, const vector<string>& sentences, vector<WordToken>& tokens,
+                    vector<size_t>& offsets, SegmentScratch& scratch) {
+    mix.GetSegmenter<HmmPolicy, FilterPolicy, OutputPolicy>().CutBatch(sentences, tokens, offsets, scratch);
+}
+
+int main(int argc, char** argv) {
+    string dict_dir = argc > 1 ? argv[1] : HOTWORDS_DICT_DIR;
+    string corpus_path = argc > 2 ? argv[2] : "";
+    int rounds = argc > 3 ? std::max(1, std::atoi(argv[3])) : 3;
+
+    string dict_path = dict_dir + "/jieba.dict.utf8";
+    string user_dict_path = dict_dir + "/user.dict.utf8";
+    string tmp_dir;
+    bool full_dict = std::filesystem::exists(dict_path);
+    if (!full_dict) {
+        tmp_dir = std::filesystem::temp_directory_path().string() + "/segmenter_bench." + std::to_string(getpid());
+        std::filesystem::create_directories(tmp_dir);
+        dict_path = tmp_dir + "/jieba.dict.utf8";
+        user_dict_path = tmp_dir + "/user.dict.utf8";
+        std::ofstream(dict_path) << "中华 300 nz\n人民 200 n\n共和国 150 n\n中华人民共和国 50 ns\n万岁 80 v\n主播 90 n\n"
+                                    "今天 120 t\n我们 500 r\n的 3000 uj\n了 2000 ul\n操作 60 vn\n弹幕 40 n\n北京 300 ns\n"
+                                    "天安门 100 ns\n南京 200 ns\n南京市 80 ns\n市长 90 n\n长江 120 ns\n大桥 60 n\n"
+                                    "长江大桥 30 ns\n真的 100 d\n你们 300 r\n什么 400 r\n";
+        std::ofstream(user_dict_path) << "前方高能 n\n";
+        std::cout << "no jieba.dict.utf8 in " << dict_dir << ", checking with a small dictionary (timings not meaningful)"
+                  << std::endl;
+    }
+
+    DictTrie trie(dict_path, user_dict_path);
+    trie.LoadStopWords(dict_dir + "/stop_words.utf8");
+    HMMModel model(dict_dir + "/hmm_model.utf8");
+    MixSegment mix(&trie, &model);
+    MPSegment mp_seg(&trie);
+    HMMSegment hmm_seg(&model);
+    RuntimeSegment runtime(mp_seg, hmm_seg, mix.GetSeparators());
+
+    vector<string> corpus;
+    if (!corpus_path.empty()) {
+        std::ifstream in(corpus_path);
+        string line;
+        while (std::getline(in, line)) corpus.push_back(line);
+    } else {
+        corpus = MakeCorpus(20000);
+    }
+    size_t bytes = 0;
+    for (const string& line : corpus) bytes += line.size();
+    std::cout << corpus.size() << " lines, " << bytes << " bytes, best of " << rounds << " rounds" << std::endl;
+
+    const Config configs[] = {
+        {"hmm  keep  coarse", true, false, false, CutWith<WithHmm, KeepAll, CoarseWords>},
+        {"hmm  keep  sub   ", true, false, true, CutWith<WithHmm, KeepAll, WithSubWords>},
+        {"hmm  drop  coarse", true, true, false, CutWith<WithHmm, DropStopWords, CoarseWords>},
+        {"hmm  drop  sub   ", true, true, true, CutWith<WithHmm, DropStopWords, WithSubWords>},
+        {"mp   keep  coarse", false, false, false, CutWith<NoHmm, KeepAll, CoarseWords>},
+        {"mp   keep  sub   ", false, false, true, CutWith<NoHmm, KeepAll, WithSubWords>},
+        {"mp   drop  coarse", false, true, false, CutWith<NoHmm, DropStopWords, CoarseWords>},
+        {"mp   drop  sub   ", false, true, true, CutWith<NoHmm, DropStopWords, WithSubWords>},
+    };
+
+    int failures = 0;
+    SegmentScratch scratch;
+    vector<WordToken> expected, actual;
+    vector<size_t> expected_offsets, actual_offsets;
+    for (const Config& config : configs) {
+        runtime.CutBatch(corpus, expected, expected_offsets, scratch, config.hmm, config.drop_stop_words, config.sub_words);
+        config.cut(mix, corpus, actual, actual_offsets, scratch);
+        bool same = SameTokens(expected, actual) && expected_offsets == actual_offsets;
+        if (!same) ++failures;
+
+        double runtime_ms = BestMs(rounds, [&]() {
+            runtime.CutBatch(corpus, expected, expected_offsets, scratch, config.hmm, config.drop_stop_words, config.sub_words);
+        });
+        double segmenter_ms = BestMs(rounds, [&]() {
+            config.cut(mix, corpus, actual, actual_offsets, scratch);
+        });
+        char line[160];
+        std::snprintf(line, sizeof(line), "%s  %8zu tokens  %s  runtime %8.2f ms  segmenter %8.2f ms  x%.2f",
+                      config.name, actual.size(), same ? "same" : "DIFFERENT", runtime_ms, segmenter_ms,
+                      segmenter_ms > 0 ? runtime_ms / segmenter_ms : 0.0);
+        std::cout << line << std::endl;
+    }
+
+    if (!tmp_dir.empty()) std::filesystem::remove_all(tmp_dir);
+    if (failures == 0) std::cout << "segmenter_bench: tokens identical in all configurations" << std::endl;
+    return failures == 0 ? 0 : 1;
+}